@@ -0,0 +1,57 @@
+#ifndef CLASSIFY_KERNEL_H
+#define CLASSIFY_KERNEL_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Promotion (hot) and demotion (cold) candidates of a block of up to 64
+ * pages; bit i stands for the i-th page of the block
+ */
+struct ClassifyMasks {
+    uint64_t hot = 0;
+    uint64_t cold = 0;
+};
+
+/**
+ * Instruction set a classification kernel is built for
+ */
+enum class ClassifyIsa {
+    SCALAR,
+    SSE41,  // 4 pages per compare
+    AVX2    // 8 pages per compare
+};
+
+/**
+ * Classify a block of pages from their dense counter and epoch arrays.
+ * A page is hot when counts[i] >= hot_threshold and cold when
+ * epochs[i] < cold_before.
+ * @param counts Access counters of the block
+ * @param epochs Last access epochs of the block
+ * @param count Number of pages, at most 64
+ * @param hot_threshold Minimum access count of a hot page
+ * @param cold_before Pages last accessed before this epoch are cold
+ * @param masks Receives the hot and cold bitmasks
+ */
+using ClassifyKernelFn = void (*)(const uint32_t* counts, const uint32_t* epochs, size_t count,
+    uint32_t hot_threshold, uint32_t cold_before, ClassifyMasks& masks);
+
+// Kernel for an instruction set; the caller checks classifyIsaSupported() first
+ClassifyKernelFn classifyKernel(ClassifyIsa isa);
+
+// Whether the running CPU supports an instruction set
+bool classifyIsaSupported(ClassifyIsa isa);
+
+// Widest instruction set supported by the running CPU
+ClassifyIsa bestClassifyIsa();
+
+const char* classifyIsaName(ClassifyIsa isa);
+
+/**
+ * Classify a block with the widest kernel the CPU supports, selected once
+ * on first use
+ */
+void classifyPages(const uint32_t* counts, const uint32_t* epochs, size_t count,
+    uint32_t hot_threshold, uint32_t cold_before, ClassifyMasks& masks);
+
+#endif // CLASSIFY_KERNEL_H
@@ -2,20 +2,58 @@
 #define CLIENT_H
 
 #include <string>
+#include <vector>
+#include <boost/chrono.hpp>
 
 #include "RingBuffer.hpp"
 #include "Common.hpp"
+#include "Trace.hpp"
 
 class Client {
 public:
-    Client(RingBuffer<ClientMessage>& buffer, size_t client_id, size_t message_cnt, size_t memory_space, AccessPattern pattern);
+    Client(const std::vector<RingBuffer<ClientMessage>*>& buffers, const ShardMap& shard_map, size_t base_page_id,
+        size_t client_id, size_t message_cnt, size_t memory_space, const AccessPatternConfig& pattern, size_t batch_size,
+        const LoadConfig& load = LoadConfig(), const std::string& record_path = "");
+    // False when the trace of a TRACE pattern could not be opened; the reader logged why
+    bool ready() const { return !replay_ || trace_; }
+    // Send the generated accesses, or replay the trace for a TRACE pattern, then END
     void run();
 
 private:
-    RingBuffer<ClientMessage>& buffer_;
+    // Stamp and push all messages to a shard, retrying until its buffer accepted every one of them
+    void sendBatch(size_t shard, ClientMessage* msgs, size_t count);
+
+    // Add an access to its shard's batch, sending the batch once full
+    void queueMessage(size_t offset, OperationType op, uint64_t intended_ns = 0);
+    void flushBatches();
+
+    // Wait for an open-loop send time, first sending what is already due
+    void waitUntil(uint64_t due_ns);
+
+    // Send time of the next open-loop request
+    uint64_t nextArrival();
+
+    // Replay this client's records of the trace, paced by their timestamps if requested
+    void replayTrace();
+
+    std::vector<RingBuffer<ClientMessage>*> buffers_;   // One request buffer per manager shard
+    ShardMap shard_map_;
+    size_t base_page_id_;
     size_t client_id_;
     size_t message_cnt_;
+    size_t batch_size_;
+    size_t memory_space_;
     MemoryAccessGenerator generator_;
+    LoadConfig load_;
+    uint64_t next_arrival_ns_ = 0;
+    std::mt19937 arrival_rng_{ std::random_device{}() };
+    std::vector<std::vector<ClientMessage>> batches_;   // Pending messages per shard
+    bool replay_ = false;                   // TRACE pattern
+    std::unique_ptr<TraceReader> trace_;    // Set when replaying a trace
+    bool trace_paced_ = false;
+    std::unique_ptr<TraceWriter> recorder_;    // Set when recording the sent accesses
+    uint64_t recorded_us_ = 0;              // Send time of the last recorded access
+    boost::chrono::steady_clock::time_point start_;
 };
 
 #endif // CLIENT_H
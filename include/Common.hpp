@@ -1,10 +1,17 @@
 #ifndef COMMON_H
 #define COMMON_H
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <sstream>
 #include <random>
 
+#include "RingBuffer.hpp"
+
 /**
  * Defines the type of memory operation that can be performed
  */
@@ -19,18 +26,59 @@ enum class OperationType {
  */
 enum class AccessPattern {
     UNIFORM,            // Uniform random access across all memory
-    SKEWED_70_20_10     // 70% access to 10% memory, 20% to next 20%, 10% to rest
+    SKEWED_70_20_10,    // 70% access to 10% memory, 20% to next 20%, 10% to rest
+    ZIPFIAN,            // Zipfian popularity, most popular pages at the start of memory
+    SCRAMBLED_ZIPFIAN,  // Zipfian popularity with the ranks permuted across memory
+    HOTSPOT,            // A fixed fraction of accesses to a hot set at the start of memory
+    LATEST,             // Zipfian over distance from the newest page, at the end of memory
+    GAUSSIAN,           // Normal distribution around the middle of memory
+    TRACE               // Replayed from a trace file by the client, never generated
+};
+
+/**
+ * Access pattern of a client with its distribution parameters, parsed from
+ * `name[:param[:param]][@option...]`, e.g. `zipf:0.99` or
+ * `skewed@shift=100000@jump`
+ */
+struct AccessPatternConfig {
+    AccessPattern type = AccessPattern::UNIFORM;
+    double zipf_theta = 0.99;           // Skew of ZIPFIAN, SCRAMBLED_ZIPFIAN and LATEST, in (0, 1)
+    double hot_set_fraction = 0.2;      // HOTSPOT: fraction of memory in the hot set
+    double hot_op_fraction = 0.8;       // HOTSPOT: fraction of accesses going to the hot set
+    double stddev_fraction = 0.1;       // GAUSSIAN: standard deviation as a fraction of memory
+
+    // Phase shifts move the whole distribution, and with it the hot region
+    size_t shift_ops = 0;               // Shift every this many accesses, 0 for never
+    size_t shift_ms = 0;                // Shift every this many milliseconds, 0 for never
+    bool shift_jump = false;            // Jump to a random position instead of rotating
+    double shift_stride = 0.1;          // Rotation per shift as a fraction of memory
+
+    // TRACE: replayed file, as fast as possible or paced by the recorded timestamps
+    std::string trace_path;
+    bool trace_paced = false;
+};
+
+/**
+ * Request schedule of a client. Closed-loop clients send as fast as the
+ * server accepts; open-loop clients send at a target rate regardless of how
+ * fast the server serves them, so queueing delay shows up in latency.
+ */
+struct LoadConfig {
+    double rate = 0;            // Requests per second per client, 0 for closed-loop
+    bool poisson = true;        // Exponential inter-arrival times, otherwise constant
 };
 
 /**
  * Represents different memory layers in the tiered memory system
  */
-enum class PageLayer {
+enum class PageLayer : uint8_t {
     NUMA_LOCAL,     // Local NUMA node
     NUMA_REMOTE,    // Remote NUMA node
     PMEM            // Persistent memory
 };
 
+constexpr size_t NUM_PAGE_LAYERS = 3;
+
 /**
  * Stream operator for PageLayer enum to enable string conversion
  * @param os Output stream
@@ -62,9 +110,104 @@ struct ServerMemoryConfig {
     size_t pmem_size;         // Size of persistent memory
 };
 
+/**
+ * Policy deciding page placement, see TieringPolicy.hpp
+ */
+enum class TieringPolicyType {
+    THRESHOLD,  // Hot access count / cold access interval
+    CLOCK,      // Second chance reference bits
+    LRU_K,      // K-th most recent access time
+    LFU,        // Decayed access frequency
+    ARC         // Adaptive replacement cache over the local tier
+};
+
 struct PolicyConfig {
+    TieringPolicyType policy_type;
     size_t hot_access_cnt;
-    size_t cold_access_interval;
+    size_t cold_access_interval;  // In epochs
+    size_t epoch_ms;              // Length of one epoch
+    size_t access_decay_shift;    // Access counters are shifted right by this on every scanner pass
+    double high_watermark;    // Fast tier occupancy fraction that starts background demotion
+    double low_watermark;     // Occupancy fraction at which background demotion stops
+};
+
+/**
+ * Configuration structure for server threads and queues
+ */
+struct ServerRuntimeConfig {
+    size_t buffer_size;               // Capacity of each ring buffer
+    RingBufferType ring_buffer_type;  // Ring buffer implementation
+    size_t batch_size;                // Max messages drained per manager wakeup
+    size_t manager_threads;           // Number of page-sharded manager workers
+    size_t migration_threads;         // Number of background migration workers
+    size_t migration_batch_size;      // Max pages per move_pages call
+    size_t migration_batch_timeout_us;    // Max time a page waits for its batch to fill
+    size_t scanner_threads;           // Number of range-partitioned scanner threads
+    size_t recovery_window_ms;        // Hit ratio window for phase shift recovery
+    std::string latency_cdf_path;     // CSV file for the latency CDFs at the end of the run, empty for none
+    std::string metrics_output_path;  // Time series of metric deltas (.csv or .jsonl), empty for none
+    size_t metrics_interval_ms;       // Interval between two time series rows
+};
+
+/**
+ * Maps global page ids to manager shards of contiguous, equally sized ranges
+ */
+struct ShardMap {
+    size_t shard_size = 1;    // Pages per shard, the last shard may hold fewer
+
+    size_t shardOf(size_t page_id) const { return page_id / shard_size; }
+};
+
+/**
+ * Zipfian distribution over ranks [0, n), rank 0 the most popular, drawn in
+ * constant time with the method of Gray et al. ("Quickly Generating
+ * Billion-Record Synthetic Databases") as used by YCSB. The zeta constant
+ * is computed once at construction.
+ */
+class ZipfianGenerator {
+private:
+    size_t items_;
+    double theta_;
+    double zeta_n_;     // sum of 1 / i^theta for i in [1, n]
+    double alpha_;
+    double eta_;
+    double half_pow_theta_;
+
+public:
+    /**
+     * @param items Number of ranks n, at least 1
+     * @param theta Skew in (0, 1); YCSB uses 0.99
+     */
+    ZipfianGenerator(size_t items, double theta)
+        : items_(std::max<size_t>(items, 1)), theta_(theta) {
+        zeta_n_ = 0;
+        for (size_t i = 1; i <= items_; ++i) {
+            zeta_n_ += 1.0 / std::pow(static_cast<double>(i), theta_);
+        }
+        double zeta_2 = 1.0 + 1.0 / std::pow(2.0, theta_);
+        alpha_ = 1.0 / (1.0 - theta_);
+        eta_ = (1.0 - std::pow(2.0 / static_cast<double>(items_), 1.0 - theta_)) / (1.0 - zeta_2 / zeta_n_);
+        half_pow_theta_ = 1.0 + std::pow(0.5, theta_);
+    }
+
+    /**
+     * Draw the next rank
+     * @param rng Random number generator
+     * @return Rank in [0, n)
+     */
+    template <typename Rng>
+    size_t next(Rng& rng) {
+        double u = std::uniform_real_distribution<double>(0, 1.0)(rng);
+        double uz = u * zeta_n_;
+        if (uz < 1.0) {
+            return 0;
+        }
+        if (uz < half_pow_theta_) {
+            return std::min<size_t>(1, items_ - 1);
+        }
+        size_t rank = static_cast<size_t>(static_cast<double>(items_) * std::pow(eta_ * u - eta_ + 1.0, alpha_));
+        return std::min(rank, items_ - 1);
+    }
 };
 
 /**
@@ -72,9 +215,40 @@ struct PolicyConfig {
  */
 class MemoryAccessGenerator {
 private:
-    AccessPattern pattern_;     // Type of access pattern to generate
+    AccessPatternConfig pattern_;   // Type of access pattern to generate
     std::mt19937 rng_;          // Random number generator
     double memory_size_;        // Total memory size to generate accesses for
+    std::unique_ptr<ZipfianGenerator> zipf_;   // Rank generator of the Zipfian based patterns
+    uint64_t scramble_mask_ = 0;    // Smallest 2^k - 1 covering every page, domain of scramble()
+
+    // Current phase: the distribution is rotated by phase_offset_ pages
+    size_t phase_ = 0;
+    size_t phase_offset_ = 0;
+    size_t phase_ops_ = 0;
+    std::chrono::steady_clock::time_point phase_start_ = std::chrono::steady_clock::now();
+
+    /**
+     * Permutation of [0, pages) scattering Zipfian ranks over memory, so no
+     * two ranks share a page. Offsets, odd multiplies and xor-shifts are
+     * bijective on k bits; values past the last page go through the mixer
+     * again until they fall in range, fewer than two rounds on average
+     * @param rank Zipfian rank in [0, pages)
+     * @param pages Number of pages, at most scramble_mask_ + 1
+     * @return Page of the rank
+     */
+    size_t scramble(size_t rank, size_t pages) const {
+        uint64_t value = rank;
+        int shift = (64 - __builtin_clzll(scramble_mask_ | 1) + 1) / 2;
+        do {
+            value = ((value + 0x632BE59BD9B4E019ULL) * 0x9E3779B97F4A7C15ULL) & scramble_mask_;
+            value ^= value >> shift;
+            value = (value * 0xBF58476D1CE4E5B9ULL) & scramble_mask_;
+            value ^= value >> shift;
+            value = (value * 0x94D049BB133111EBULL) & scramble_mask_;
+            value ^= value >> shift;
+        } while (value >= pages);
+        return static_cast<size_t>(value);
+    }
 
 public:
     /**
@@ -82,20 +256,61 @@ public:
      * @param pattern Access pattern type to use
      * @param memory_size Total memory size for generating offsets
      */
-    MemoryAccessGenerator(AccessPattern pattern, double memory_size)
+    MemoryAccessGenerator(const AccessPatternConfig& pattern, double memory_size)
         : pattern_(pattern), memory_size_(memory_size) {
         std::random_device rd;
         rng_ = std::mt19937(rd());
+        if (pattern_.type == AccessPattern::ZIPFIAN || pattern_.type == AccessPattern::SCRAMBLED_ZIPFIAN
+            || pattern_.type == AccessPattern::LATEST) {
+            zipf_ = std::make_unique<ZipfianGenerator>(static_cast<size_t>(memory_size_), pattern_.zipf_theta);
+        }
+        size_t pages = static_cast<size_t>(memory_size_);
+        while (scramble_mask_ + 1 < pages) {
+            scramble_mask_ = (scramble_mask_ << 1) | 1;
+        }
     }
 
     /**
-     * Generates a memory offset according to the specified access pattern
+     * Generates a memory offset according to the specified access pattern,
+     * shifting to the next phase first when the current one is over
      * @return Generated memory offset
      */
     size_t generateOffset() {
+        if ((pattern_.shift_ops > 0 && phase_ops_ >= pattern_.shift_ops)
+            || (pattern_.shift_ms > 0
+                && std::chrono::steady_clock::now() - phase_start_ >= std::chrono::milliseconds(pattern_.shift_ms))) {
+            shiftPhase();
+        }
+        ++phase_ops_;
+        size_t offset = drawOffset();
+        return phase_offset_ > 0 ? (offset + phase_offset_) % static_cast<size_t>(memory_size_) : offset;
+    }
+
+    // Number of phase shifts so far
+    size_t phase() const { return phase_; }
+
+private:
+    // Move the distribution: rotate by shift_stride of memory, or jump to a random position
+    void shiftPhase() {
+        size_t pages = static_cast<size_t>(memory_size_);
+        if (pattern_.shift_jump) {
+            phase_offset_ = std::uniform_int_distribution<size_t>(0, pages - 1)(rng_);
+        }
+        else {
+            size_t stride = std::max<size_t>(static_cast<size_t>(memory_size_ * pattern_.shift_stride), 1);
+            phase_offset_ = (phase_offset_ + stride) % pages;
+        }
+        ++phase_;
+        phase_ops_ = 0;
+        phase_start_ = std::chrono::steady_clock::now();
+    }
+
+    // Offset drawn from the stationary distribution, before the phase rotation
+    size_t drawOffset() {
         std::uniform_real_distribution<double> uniform(0, 1.0);
+        size_t pages = static_cast<size_t>(memory_size_);
 
-        switch (pattern_) {
+        switch (pattern_.type) {
         case AccessPattern::UNIFORM: {
             std::uniform_int_distribution<size_t> dist(0, memory_size_ - 1);
             return dist(rng_);
@@ -119,6 +334,33 @@ public:
                 return cold(rng_);
             }
         }
+
+        case AccessPattern::ZIPFIAN:
+            return zipf_->next(rng_);
+
+        case AccessPattern::SCRAMBLED_ZIPFIAN:
+            return scramble(zipf_->next(rng_), pages);
+
+        case AccessPattern::HOTSPOT: {
+            size_t hot_pages = std::min(std::max<size_t>(static_cast<size_t>(memory_size_ * pattern_.hot_set_fraction), 1), pages);
+            if (uniform(rng_) < pattern_.hot_op_fraction || hot_pages == pages) {
+                return std::uniform_int_distribution<size_t>(0, hot_pages - 1)(rng_);
+            }
+            return std::uniform_int_distribution<size_t>(hot_pages, pages - 1)(rng_);
+        }
+
+        case AccessPattern::LATEST:
+            // The client never inserts, so the newest page is the last one
+            return pages - 1 - zipf_->next(rng_);
+
+        case AccessPattern::GAUSSIAN: {
+            std::normal_distribution<double> normal(memory_size_ / 2, memory_size_ * pattern_.stddev_fraction);
+            double offset = std::round(normal(rng_));
+            return static_cast<size_t>(std::min(std::max(offset, 0.0), memory_size_ - 1));
+        }
+
+        case AccessPattern::TRACE:
+            break;
         }
         return 0;
     }
@@ -131,15 +373,18 @@ struct ClientMessage {
     size_t client_id;        // Unique client identifier for the client
     size_t offset;           // Page identifier offset to access
     OperationType op_type;   // Type of operation to perform
+    uint64_t intended_ns;    // Scheduled send time of an open-loop request, 0 for closed-loop
+    uint64_t enqueue_ns = 0; // Time the client pushed the message to the request buffer
 
     /**
      * Constructor for client message
      * @param id Client identifier
      * @param off Page identifier offset
      * @param op Operation type
+     * @param intended Scheduled send time (CLOCK_MONOTONIC ns), 0 if not scheduled
      */
-    ClientMessage(size_t id, size_t off, OperationType op)
-        : client_id(id), offset(off), op_type(op) {
+    ClientMessage(size_t id = 0, size_t off = 0, OperationType op = OperationType::READ, uint64_t intended = 0)
+        : client_id(id), offset(off), op_type(op), intended_ns(intended) {
     }
 
     /**
@@ -167,7 +412,7 @@ struct MemMoveReq {
      * @param page_id   Page identifier
      * @param layer_id  Destination layer
      */
-    MemMoveReq(size_t page_id, PageLayer layer_id)
+    MemMoveReq(size_t page_id = 0, PageLayer layer_id = PageLayer::NUMA_LOCAL)
         : page_id(page_id), layer_id(layer_id) {
     }
 
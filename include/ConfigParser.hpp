@@ -10,7 +10,7 @@
 class ConfigParser {
 public:
     struct ClientConfig {
-        AccessPattern pattern;
+        AccessPatternConfig pattern;
         size_t addr_space_size;
     };
 
@@ -18,23 +18,41 @@ public:
     bool parse(int argc, char* argv[]);
 
     // Getters for configuration
-    size_t getBufferSize() const { return buffer_size_; }
+    size_t getBufferSize() const { return server_runtime_config_.buffer_size; }
+    RingBufferType getRingBufferType() const { return server_runtime_config_.ring_buffer_type; }
     size_t getMessageCount() const { return message_count_; }
     const std::vector<ClientConfig>& getClientConfigs() const { return client_configs_; }
     const ServerMemoryConfig& getServerMemoryConfig() const { return server_memory_config_; }
     const PolicyConfig& getPolicyConfig() const { return policy_config_; }
+    const ServerRuntimeConfig& getServerRuntimeConfig() const { return server_runtime_config_; }
+    const std::string& getRecordTracePrefix() const { return record_trace_prefix_; }
+    const LoadConfig& getLoadConfig() const { return load_config_; }
 
     bool isHelpRequested() const { return help_requested_; }
 
 private:
     void printConfig() const;
 
+    /**
+     * Parse a client access pattern, `name[:param[:param]][@option...]`
+     * @param spec Pattern specification, e.g. `zipf:0.99` or `skewed@shift=100000@jump`
+     * @param pattern Receives the parsed pattern
+     * @return true if spec names a known pattern with valid parameters
+     */
+    static bool parsePattern(const std::string& spec, AccessPatternConfig& pattern);
+
+    // Pattern specification in the form parsePattern() accepts
+    static std::string patternName(const AccessPatternConfig& pattern);
+
     cxxopts::Options options_;
-    size_t buffer_size_;
     size_t message_count_;
     std::vector<ClientConfig> client_configs_;
     ServerMemoryConfig server_memory_config_;
     PolicyConfig policy_config_;
+    std::string policy_name_;
+    LoadConfig load_config_;
+    std::string record_trace_prefix_;   // Client i records to <prefix>.<i>.trace, empty to not record
+    ServerRuntimeConfig server_runtime_config_;
     bool help_requested_;
 };
 
@@ -1,19 +1,158 @@
 #ifndef METRICS_H
 #define METRICS_H
 
+#include <array>
 #include <atomic>
 #include <cstdint>
-#include <boost/accumulators/accumulators.hpp>
-#include <boost/accumulators/statistics/stats.hpp>
-#include <boost/accumulators/statistics/mean.hpp>
-#include <boost/accumulators/statistics/min.hpp>
-#include <boost/accumulators/statistics/max.hpp>
-#include <boost/accumulators/statistics/extended_p_square.hpp>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/lock_guard.hpp>
 
-namespace acc = boost::accumulators;
+#include "Utils.hpp"
 
 /**
- * Memory metrics collector with atomic counters
+ * HDR-style latency histogram with log-linear buckets: values are grouped
+ * by power of two and every power of two is split into SUB_BUCKETS linear
+ * buckets, so a percentile is off by at most 1 / SUB_BUCKETS (1.6%) at any
+ * magnitude. Values from 2^MAX_VALUE_BITS ns (about 18 minutes) up share the
+ * top bucket.
+ *
+ * Every recording thread gets its own shard on first use, so record() is a
+ * few relaxed loads and stores to memory no other thread writes. Readers
+ * merge the shards into a Snapshot; a read concurrent with recording may
+ * miss the values being recorded but never sees a torn count.
+ */
+class LatencyHistogram {
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 6;
+    static constexpr unsigned MAX_VALUE_BITS = 40;
+    static constexpr size_t SUB_BUCKETS = size_t(1) << SUB_BUCKET_BITS;
+    static constexpr size_t NUM_BUCKETS = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS;
+
+    /**
+     * Merged contents of all shards at one point in time
+     */
+    struct Snapshot {
+        std::vector<uint64_t> counts = std::vector<uint64_t>(NUM_BUCKETS);
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t min = 0;       // Exact, 0 if empty
+        uint64_t max = 0;
+
+        double mean() const { return count > 0 ? static_cast<double>(sum) / count : 0.0; }
+
+        /**
+         * Value at a percentile
+         * @param percentile In [0, 100], e.g. 99.9
+         * @return Midpoint of the bucket holding the percentile clamped to [min, max], 0 if empty
+         */
+        double percentile(double percentile) const;
+
+        /**
+         * Values recorded since an earlier snapshot of the same histogram
+         * @param earlier Snapshot taken before this one
+         * @return Difference; min and max are bounded by the buckets that changed
+         */
+        Snapshot since(const Snapshot& earlier) const;
+    };
+
+    LatencyHistogram();
+    ~LatencyHistogram();
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    inline void record(uint64_t value) {
+        Shard& shard = localShard();
+        // Only the owning thread writes its shard, so no read-modify-write is needed
+        std::atomic<uint64_t>& bucket = shard.counts[bucketOf(value)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        shard.count.store(shard.count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        shard.sum.store(shard.sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        if (value < shard.min.load(std::memory_order_relaxed)) {
+            shard.min.store(value, std::memory_order_relaxed);
+        }
+        if (value > shard.max.load(std::memory_order_relaxed)) {
+            shard.max.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    uint64_t count() const;
+    Snapshot snapshot() const;
+    double percentile(double percentile) const { return snapshot().percentile(percentile); }
+
+    /**
+     * Write the cumulative distribution as CSV rows "name,value_ns,count,fraction",
+     * one per non-empty bucket, value_ns being the bucket's upper bound
+     * @param out Destination stream
+     * @param name First column of every row
+     */
+    void writeCdf(std::ostream& out, const std::string& name) const;
+
+    // Clear all shards; values recorded concurrently may survive the reset
+    void reset();
+
+    // Lowest value of a bucket and the number of values it covers
+    static uint64_t bucketLow(size_t bucket) {
+        if (bucket < SUB_BUCKETS) {
+            return bucket;
+        }
+        unsigned shift = static_cast<unsigned>(bucket >> SUB_BUCKET_BITS) - 1;
+        return (SUB_BUCKETS | (bucket & (SUB_BUCKETS - 1))) << shift;
+    }
+    static uint64_t bucketWidth(size_t bucket) {
+        return bucket < SUB_BUCKETS ? 1 : uint64_t(1) << ((bucket >> SUB_BUCKET_BITS) - 1);
+    }
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> counts[NUM_BUCKETS];
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> sum;
+        std::atomic<uint64_t> min;
+        std::atomic<uint64_t> max;
+        Shard* next = nullptr;      // Next shard of the same histogram
+
+        Shard() { clear(); }
+        void clear();
+    };
+
+    static size_t bucketOf(uint64_t value) {
+        if (value < SUB_BUCKETS) {
+            return static_cast<size_t>(value);
+        }
+        unsigned msb = 63 - __builtin_clzll(value);
+        if (msb >= MAX_VALUE_BITS) {
+            return NUM_BUCKETS - 1;
+        }
+        unsigned shift = msb - SUB_BUCKET_BITS;
+        return ((shift + 1) << SUB_BUCKET_BITS) + ((value >> shift) & (SUB_BUCKETS - 1));
+    }
+
+    // Shard of the calling thread, created on its first record()
+    inline Shard& localShard() {
+        // Indexed by histogram id; ids are never reused, so entries of
+        // destroyed histograms are simply never looked up again
+        thread_local std::vector<Shard*> shards;
+        if (id_ < shards.size() && shards[id_] != nullptr) {
+            return *shards[id_];
+        }
+        return addShard(shards);
+    }
+    Shard& addShard(std::vector<Shard*>& thread_shards);
+
+    size_t id_;
+    std::atomic<Shard*> shards_{ nullptr };     // Lock-free list of all shards
+    static std::atomic<size_t> next_id_;
+};
+
+/**
+ * Memory metrics collector. Counters are sharded per thread: every
+ * recording thread owns a cache-line aligned CounterShard that only it
+ * writes, so recording is a plain load and store with no cache line shared
+ * between threads. Reads sum the shards.
  */
 class Metrics {
 public:
@@ -28,70 +167,212 @@ public:
     Metrics(Metrics&&) = delete;
     Metrics& operator=(Metrics&&) = delete;
 
+    enum Counter : size_t {
+        LOCAL_ACCESS,
+        REMOTE_ACCESS,
+        PMEM_ACCESS,
+        MIGRATING_ACCESS,           // Accesses that hit a page while it was migrating
+        LOCAL_TO_REMOTE,
+        REMOTE_TO_LOCAL,
+        PMEM_TO_REMOTE,
+        REMOTE_TO_PMEM,
+        LOCAL_TO_PMEM,
+        PMEM_TO_LOCAL,
+        MIGRATION_BATCHES,
+        MIGRATION_BATCH_PAGES,
+        MIGRATION_BATCH_LATENCY,
+        MIGRATION_FAILURES,
+        CANCELLED_MOVES,            // Queued moves withdrawn by the scanner
+        REFUSED_MOVES,              // Moves refused because the destination was full
+        RECLAIM_DEMOTIONS,          // Demotions requested by watermark reclaim
+        PHASE_SHIFTS,
+        TOTAL_LATENCY,              // Access plus migration latency, for throughput
+        NUM_COUNTERS
+    };
+    using CounterSnapshot = std::array<uint64_t, NUM_COUNTERS>;
+
     // Access counters
-    inline void incrementLocalAccess() { local_access_count_++; }
-    inline void incrementRemoteAccess() { remote_access_count_++; }
-    inline void incrementPmemAccess() { pmem_access_count_++; }
+    inline void incrementLocalAccess() { add(LOCAL_ACCESS); }
+    inline void incrementRemoteAccess() { add(REMOTE_ACCESS); }
+    inline void incrementPmemAccess() { add(PMEM_ACCESS); }
+    inline void incrementMigratingAccess() { add(MIGRATING_ACCESS); }
 
     // Migration counters
-    inline void incrementLocalToRemote() { local_to_remote_count_++; }
-    inline void incrementRemoteToLocal() { remote_to_local_count_++; }
-    inline void incrementPmemToRemote() { pmem_to_remote_count_++; }
-    inline void incrementRemoteToPmem() { remote_to_pmem_count_++; }
-    inline void incrementLocalToPmem() { local_to_pmem_count_++; }
-    inline void incrementPmemToLocal() { pmem_to_local_count_++; }
+    inline void incrementLocalToRemote() { add(LOCAL_TO_REMOTE); }
+    inline void incrementRemoteToLocal() { add(REMOTE_TO_LOCAL); }
+    inline void incrementPmemToRemote() { add(PMEM_TO_REMOTE); }
+    inline void incrementRemoteToPmem() { add(REMOTE_TO_PMEM); }
+    inline void incrementLocalToPmem() { add(LOCAL_TO_PMEM); }
+    inline void incrementPmemToLocal() { add(PMEM_TO_LOCAL); }
 
     // Latency recording
     inline void recordAccessLatency(uint64_t latency_ns) {
-        access_latency_(latency_ns);
-        total_latency_ += latency_ns;
+        access_latency_.record(latency_ns);
+        add(TOTAL_LATENCY, latency_ns);
+    }
+
+    // Open-loop request: intended send time to completion, including queueing
+    inline void recordRequestLatency(uint64_t latency_ns) { request_latency_.record(latency_ns); }
+
+    const LatencyHistogram& accessLatency() const { return access_latency_; }
+    const LatencyHistogram& migrationBatchLatency() const { return migration_batch_latency_; }
+
+    /**
+     * Break a served request down into the time it waited in the request
+     * buffer and behind earlier requests, and the time the manager spent on
+     * it; end-to-end latency is their sum
+     * @param client_id Client that sent the request
+     * @param tier Tier the page was served from
+     * @param queue_ns Enqueue to start of service
+     * @param service_ns Start of service to completion
+     */
+    inline void recordRequestBreakdown(size_t client_id, PageLayer tier, uint64_t queue_ns, uint64_t service_ns) {
+        for (LatencyBreakdown* breakdown : { &client_breakdown_[client_id], &tier_breakdown_[static_cast<size_t>(tier)] }) {
+            breakdown->queue_wait.record(queue_ns);
+            breakdown->service.record(service_ns);
+            breakdown->end_to_end.record(queue_ns + service_ns);
+        }
+    }
+
+    // Size the per-client latency breakdown; call before any request is recorded
+    void setNumClients(size_t num_clients);
+
+    // One move_pages call covering page_count pages; the latency is recorded once per batch, not per page
+    inline void recordMigrationBatch(uint64_t latency_ns, size_t page_count) {
+        migration_batch_latency_.record(latency_ns);
+        add(TOTAL_LATENCY, latency_ns);
+        add(MIGRATION_BATCHES);
+        add(MIGRATION_BATCH_PAGES, page_count);
+        add(MIGRATION_BATCH_LATENCY, latency_ns);
     }
+    inline void incrementMigrationFailure() { add(MIGRATION_FAILURES); }
+    inline void incrementCancelledMove() { add(CANCELLED_MOVES); }
+    inline void incrementRefusedMove() { add(REFUSED_MOVES); }
+    inline void incrementReclaimDemotion() { add(RECLAIM_DEMOTIONS); }
 
-    inline void recordMigrationLatency(uint64_t latency_ns) {
-        migration_latency_(latency_ns);
-        total_latency_ += latency_ns;
+    // A client's access pattern moved its hot region; consecutive shifts
+    // before the next window sample count as one recovery
+    inline void recordPhaseShift() {
+        add(PHASE_SHIFTS);
+        uint64_t none = 0;
+        pending_shift_ns_.compare_exchange_strong(none, get_time_ns());
     }
 
+    /**
+     * Close one hit ratio window and track recovery from phase shifts. The
+     * first WARMUP_WINDOWS windows with accesses are skipped; the steady
+     * state is then the mean hit ratio of the last STEADY_WINDOWS windows
+     * outside any recovery. After a shift, the tier has recovered at the
+     * first window within RECOVERY_TOLERANCE of it. A shift arriving while
+     * a recovery is running restarts its timing against the same target.
+     * Called by a single monitor thread.
+     * @param now_ns End of the window
+     */
+    void sampleHitRatioWindow(uint64_t now_ns);
+    static constexpr double RECOVERY_TOLERANCE = 0.05;
+    static constexpr size_t STEADY_WINDOWS = 10;
+    static constexpr size_t WARMUP_WINDOWS = 10;
+
+    /**
+     * Sum of a counter over all threads
+     * @param counter Counter to read
+     * @return Total; increments racing with the read may or may not be included
+     */
+    uint64_t counter(Counter counter) const;
+
+    // All counters, summed in one pass over the shards
+    CounterSnapshot counters() const;
+
+    // Start of the measured run, used for the wall-clock rate
+    void startTimer();
+
     // Print current metrics (call periodically or at program end)
     void printMetricsThreeTiers() const;
     void printMetricsTwoTiers() const;
 
+    /**
+     * Export the full latency CDFs as CSV, see LatencyHistogram::writeCdf()
+     * @param path Output file, replaced if it exists
+     * @return false if the file cannot be written
+     */
+    bool writeLatencyCdf(const std::string& path) const;
+
     // Reset all counters
     void reset();
 
 private:
     Metrics() = default;  // Private constructor for singleton
+    ~Metrics();
 
-    // Access counters
-    std::atomic<uint64_t> local_access_count_{ 0 };
-    std::atomic<uint64_t> remote_access_count_{ 0 };
-    std::atomic<uint64_t> pmem_access_count_{ 0 };
+    /**
+     * Counters written by one thread
+     */
+    struct alignas(64) CounterShard {
+        std::atomic<uint64_t> values[NUM_COUNTERS] = {};
+        CounterShard* next = nullptr;
+    };
 
-    // Migration counters
-    std::atomic<uint64_t> local_to_remote_count_{ 0 };
-    std::atomic<uint64_t> remote_to_local_count_{ 0 };
-    std::atomic<uint64_t> pmem_to_remote_count_{ 0 };
-    std::atomic<uint64_t> remote_to_pmem_count_{ 0 };
-    std::atomic<uint64_t> local_to_pmem_count_{ 0 };
-    std::atomic<uint64_t> pmem_to_local_count_{ 0 };
+    inline void add(Counter counter, uint64_t value = 1) {
+        // One shard per thread; the metrics are a singleton, so a plain thread_local suffices
+        thread_local CounterShard* shard = nullptr;
+        if (shard == nullptr) {
+            shard = addCounterShard();
+        }
+        std::atomic<uint64_t>& slot = shard->values[counter];
+        slot.store(slot.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+    CounterShard* addCounterShard();
+
+    std::atomic<CounterShard*> counter_shards_{ nullptr };     // Lock-free list of all shards
+
+    // Phase shift recovery, see sampleHitRatioWindow()
+    std::atomic<uint64_t> pending_shift_ns_{ 0 };   // First shift not yet seen by the monitor, 0 if none
+    struct RecoveryTracker {
+        uint64_t window_local = 0;      // Counters at the end of the previous window
+        uint64_t window_total = 0;
+        size_t warmup_windows = 0;      // Windows with accesses skipped so far
+        std::array<double, STEADY_WINDOWS> steady{};    // Trailing hit ratios outside recoveries
+        size_t steady_windows = 0;      // Windows written to steady, the next one goes to % STEADY_WINDOWS
+        bool recovering = false;
+        uint64_t shift_ns = 0;          // Latest shift of the current recovery
+        double target = 0;              // Hit ratio that ends it
+        size_t started = 0;             // Recoveries started
+        size_t restarted = 0;           // Shifts that arrived during a recovery
+        size_t untracked = 0;           // Shifts before there was a steady state
+        size_t recoveries = 0;
+        uint64_t recovery_total_ns = 0;
+        uint64_t recovery_max_ns = 0;
+    } recovery_;
+    mutable boost::mutex recovery_mutex_;
 
     // Latency tracking
-    static constexpr double probabilities[] = { 0.0, 0.50, 0.99 };
-
-    using AccumulatorType = acc::accumulator_set<uint64_t,
-        acc::stats<
-        acc::tag::mean,
-        acc::tag::min,
-        acc::tag::max,
-        acc::tag::extended_p_square
-        >
-    >;
-
-    AccumulatorType access_latency_{ acc::tag::extended_p_square::probabilities = probabilities };
-    AccumulatorType migration_latency_{ acc::tag::extended_p_square::probabilities = probabilities };
-
-    // Total latency tracking for throughput calculation
-    std::atomic<uint64_t> total_latency_{ 0 };
+    LatencyHistogram access_latency_;
+    LatencyHistogram migration_batch_latency_;
+    LatencyHistogram request_latency_;
+
+    // Queue wait, service time and end-to-end latency of one client or tier
+    struct LatencyBreakdown {
+        LatencyHistogram queue_wait;
+        LatencyHistogram service;
+        LatencyHistogram end_to_end;
+    };
+    LatencyBreakdown tier_breakdown_[NUM_PAGE_LAYERS];
+    std::unique_ptr<LatencyBreakdown[]> client_breakdown_;
+    size_t num_clients_ = 0;
+
+    std::atomic<uint64_t> start_time_ns_{ 0 };
+
+    // Accesses per second of wall-clock time since startTimer()
+    double wallClockRate(uint64_t total_access) const;
+    void printMigrationBatches(const CounterSnapshot& counters) const;
+    void printPhaseRecovery() const;
+    void printRequestLatency() const;
+    // Min/P50/P99/Max/Mean lines of one distribution, then its tail percentiles
+    void printLatency(const char* title, const LatencyHistogram& latency) const;
+    void printLatencyBreakdown(const char* const tier_names[], size_t num_tiers) const;
+
+    // Fraction of accesses served by the local (DRAM) tier
+    static double localHitRatio(const CounterSnapshot& counters);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,65 @@
+#ifndef METRICS_SAMPLER_H
+#define METRICS_SAMPLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Metrics.hpp"
+
+/**
+ * Writes the metrics as a time series: every sample() appends one row with
+ * the accesses per tier, migrations per direction, access and migration
+ * batch latency percentiles and throughput of the interval since the previous
+ * row, plus the current queue depths. Rows are CSV with a header line, or
+ * one JSON object per line when the file name ends in .json or .jsonl.
+ */
+class MetricsSampler {
+public:
+    enum class Format { CSV, JSON_LINES };
+
+    /**
+     * Create the output file and take the baseline of the first interval
+     * @param path Output file, truncated if it exists; the extension picks the format
+     * @param num_tiers Number of memory tiers, selects the per-tier columns
+     * @return Sampler, nullptr if the file cannot be created
+     */
+    static std::unique_ptr<MetricsSampler> open(const std::string& path, size_t num_tiers);
+
+    MetricsSampler(const MetricsSampler&) = delete;
+    MetricsSampler& operator=(const MetricsSampler&) = delete;
+
+    /**
+     * Append the row of the interval ending now; called by a single thread
+     * @param now_ns End of the interval
+     * @param request_queue Requests waiting in the manager request buffers
+     * @param migration_queue Move requests waiting for the migration workers
+     */
+    void sample(uint64_t now_ns, size_t request_queue, size_t migration_queue);
+
+private:
+    using Row = std::vector<std::pair<const char*, double>>;
+
+    MetricsSampler(const std::string& path, Format format, size_t num_tiers);
+
+    void writeHeader(const Row& row);
+    void writeRow(const Row& row);
+
+    std::ofstream out_;
+    Format format_;
+    size_t num_tiers_;
+    bool header_written_ = false;
+
+    // End of the previous interval
+    uint64_t start_ns_;
+    uint64_t previous_ns_;
+    Metrics::CounterSnapshot previous_counters_;
+    LatencyHistogram::Snapshot previous_access_;
+    LatencyHistogram::Snapshot previous_migration_;
+};
+
+#endif // METRICS_SAMPLER_H
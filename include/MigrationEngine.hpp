@@ -0,0 +1,65 @@
+#ifndef MIGRATION_ENGINE_H
+#define MIGRATION_ENGINE_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <boost/chrono.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "RingBuffer.hpp"
+#include "PageTable.hpp"
+#include "Common.hpp"
+
+/**
+ * Pool of migration workers that moves pages in the background.
+ *
+ * Move requests are routed to a worker by page id, so a page is never
+ * moved by two workers at once. Each worker groups its requests by
+ * destination layer and submits a group as one vectored move_pages call
+ * once it holds batch_size pages or its oldest request waited batch_timeout.
+ * A request only moves its page if the page is still QUEUED for that
+ * target; the page is then flagged MIGRATING from the moment it joins a
+ * batch until the call returns. Client accesses keep going to the page in
+ * the meantime.
+ */
+class MigrationEngine {
+public:
+    MigrationEngine(PageTable& page_table, const ServerRuntimeConfig& config);
+    ~MigrationEngine();
+
+    // Queue a move request, waiting up to timeout for room in the worker's buffer
+    bool submit(const MemMoveReq& req, boost::chrono::nanoseconds timeout);
+
+    // Move requests waiting in the workers' buffers, not yet taken into a batch
+    size_t queueDepth() const;
+
+    void start();
+    void stop();
+
+private:
+    /**
+     * Pages waiting to be moved to one destination layer
+     */
+    struct PendingBatch {
+        std::vector<size_t> page_ids;
+        std::vector<void*> pages;
+        std::vector<PageLayer> sources;
+        std::vector<int> nodes;
+        std::vector<int> status;
+        uint64_t oldest_ns = 0;     // Time the first page joined the batch
+    };
+
+    void runWorker(size_t worker_id);
+    void enqueue(const MemMoveReq& req, std::vector<PendingBatch>& pending);
+    void flush(PageLayer target, PendingBatch& batch);
+
+    PageTable& page_table_;
+    std::vector<std::unique_ptr<RingBuffer<MemMoveReq>>> move_page_buffers_;   // One per worker
+    size_t batch_size_;
+    uint64_t batch_timeout_ns_;
+    boost::thread_group workers_;
+    std::atomic<bool> running_{ false };
+};
+
+#endif // MIGRATION_ENGINE_H
@@ -1,22 +1,51 @@
 #ifndef PAGETABLE_H
 #define PAGETABLE_H
 
-#include <boost/thread/shared_mutex.hpp>
-#include <boost/thread/locks.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <vector>
 
 #include "Common.hpp"
 #include "Utils.hpp"
+#include "ClassifyKernel.hpp"
 
-struct PageMetadata {
-    void* page_address;
-    PageLayer page_layer;
-    boost::chrono::steady_clock::time_point last_access_time;
-    size_t access_count = 0;
+/**
+ * Migration state of a page
+ */
+enum class PageState : uint8_t {
+    RESIDENT,   // Page stays on its layer
+    QUEUED,     // A move request for the page waits in the migration engine
+    MIGRATING   // A migration worker is moving the page
+};
 
-    PageMetadata(void* addr = 0, PageLayer layer = PageLayer::NUMA_LOCAL);
+/**
+ * By-value snapshot of one page table entry returned by
+ * PageTable::getPage(), assembled from the per-field arrays; the table
+ * itself stores no PageMetadata. The page address is derived from its
+ * frame with PageTable::pageAddress().
+ */
+struct PageMetadata {
+    uint32_t frame = 0;                 // Frame index into the tier memory regions
+    uint32_t last_access_epoch = 0;     // Epoch ticks since the server started
+    uint32_t access_count = 0;          // Saturates at UINT32_MAX
+    PageLayer page_layer = PageLayer::NUMA_LOCAL;
+    PageState page_state = PageState::RESIDENT;
+    PageLayer migration_target = PageLayer::NUMA_LOCAL;    // Destination while QUEUED or MIGRATING
 };
 
+/**
+ * Page table stored as a struct of arrays: the scanner only streams through
+ * the fields it compares (counter, epoch) instead of whole entries. Pages
+ * are identified by a frame index into the per-tier memory regions rather
+ * than by a raw pointer; migrations move the physical page behind the same
+ * address, so the frame never changes after initialisation.
+ *
+ * 13 bytes per page: a flags byte, 32-bit frame, counter and epoch.
+ * No operation takes a lock once the table is initialised. Counter and
+ * epoch are relaxed atomics; layer, migration state and migration target
+ * share the flags byte and change together under one CAS.
+ */
 class PageTable {
 public:
     PageTable(size_t size);
@@ -24,20 +53,107 @@ public:
 
     // Read-only operations
     PageMetadata getPage(size_t index) const;
-    size_t getNextPageId() const;
     size_t size() const;
+    void* pageAddress(const PageMetadata& page) const { return frameAddress(page.frame); }
+
+    // Coarse clock published by the epoch ticker; a relaxed load instead of a clock read per access
+    uint32_t currentEpoch() const { return epoch_.load(std::memory_order_relaxed); }
+    void advanceEpoch(uint32_t epoch) { epoch_.store(epoch, std::memory_order_relaxed); }
 
-    // Write operations  
+    // Hint the CPU to pull a page's metadata into cache ahead of its access
+    void prefetch(size_t index) const {
+        if (index < size_) {
+            __builtin_prefetch(&page_flags_[index], 0);
+            __builtin_prefetch(&page_frame_[index], 0);
+            __builtin_prefetch(&access_count_[index], 1);
+            __builtin_prefetch(&last_access_epoch_[index], 1);
+        }
+    }
+
+    /**
+     * Classify up to 64 consecutive pages straight from the counter and
+     * epoch arrays with the SIMD kernel. The arrays are read as a racy
+     * snapshot, like any relaxed load.
+     * @param begin First page id
+     * @param count Number of pages, at most 64
+     * @param hot_threshold Minimum access count of a hot page
+     * @param cold_interval Idle epochs after which a page is cold
+     * @param now Current epoch
+     * @return Hot and cold bitmasks of the block
+     */
+    ClassifyMasks classifyBlock(size_t begin, size_t count, uint32_t hot_threshold, uint32_t cold_interval, uint32_t now) const;
+
+    // Write operations
     void updatePage(size_t index, const PageMetadata& metadata);
     void updateAccess(size_t index);
     void updatePageLayer(size_t index, PageLayer new_layer);
-    PageMetadata scanNext();
-    void resetAccessCount();
+
+    /**
+     * Age the access counters of a block of pages so that hotness reflects
+     * recent accesses. The decay subtracts from each counter, so it runs
+     * alongside updateAccess() without losing a concurrent increment.
+     * @param begin First page id
+     * @param count Number of pages
+     * @param shift Bits to shift each counter right by; 1 halves it
+     */
+    void decayAccessCounts(size_t begin, size_t count, unsigned shift);
+
+    // Per-tier occupancy, bounded by the configured tier sizes. A migration
+    // reserves a slot on its destination before moving and releases the
+    // slot on its source once the move is done.
+    bool reserveSlot(PageLayer layer);
+    void releaseSlot(PageLayer layer);
+    size_t tierPages(PageLayer layer) const;
+    size_t tierCapacity(PageLayer layer) const;
+
+    // Migration state machine RESIDENT -> QUEUED -> MIGRATING -> RESIDENT.
+    // queue fails unless the page is resident; cancel and begin only succeed
+    // while the page is still queued for that target, so a stale request
+    // never moves a page. finish publishes the new layer, abort keeps the old one.
+    bool queueMigration(size_t index, PageLayer target);
+    bool cancelMigration(size_t index, PageLayer target);
+    bool beginMigration(size_t index, PageLayer target);
+    void finishMigration(size_t index, PageLayer new_layer);
+    void abortMigration(size_t index);
 
 private:
-    std::vector<PageMetadata> table_;
-    mutable boost::shared_mutex mutex_;
-    size_t current_index_;
+    static constexpr size_t NUM_REGIONS = 3;   // Indexed by PageLayer
+
+    // Flags byte of a page: bits 0-1 layer, 2-3 PageState, 4-5 migration target
+    static constexpr unsigned STATE_SHIFT = 2;
+    static constexpr uint8_t LAYER_MASK = 0x3;
+    static uint8_t packState(PageState state, PageLayer target) {
+        return static_cast<uint8_t>(static_cast<uint8_t>(state) | (static_cast<uint8_t>(target) << 2));
+    }
+    static uint8_t packFlags(PageLayer layer, PageState state, PageLayer target) {
+        return static_cast<uint8_t>(static_cast<uint8_t>(layer) | (packState(state, target) << STATE_SHIFT));
+    }
+
+    // Replace state and target of a page whose state and target equal expected, keeping its layer
+    bool transitionState(size_t index, uint8_t expected, uint8_t desired);
+    // Set the layer of a page, keeping its state and target
+    void storeLayer(size_t index, PageLayer layer);
+
+    void resize(size_t size);
+    void* frameAddress(uint32_t frame) const;
+    PageMetadata readPage(size_t index) const;
+
+    // Dense per-field arrays, one element per page
+    size_t size_ = 0;
+    std::unique_ptr<std::atomic<uint8_t>[]> page_flags_;       // See packFlags()
+    std::unique_ptr<std::atomic<uint32_t>[]> page_frame_;
+    std::unique_ptr<std::atomic<uint32_t>[]> access_count_;
+    std::unique_ptr<std::atomic<uint32_t>[]> last_access_epoch_;
+
+    // Memory region backing each frame range: frames [region_first_frame_[r], region_first_frame_[r + 1])
+    void* region_base_[NUM_REGIONS] = { nullptr, nullptr, nullptr };
+    uint32_t region_first_frame_[NUM_REGIONS + 1] = { 0, 0, 0, 0 };
+
+    // Pages held and slots available per tier
+    std::atomic<size_t> tier_pages_[NUM_REGIONS];
+    size_t tier_capacity_[NUM_REGIONS] = { 0, 0, 0 };
+
+    std::atomic<uint32_t> epoch_{ 0 };
 };
 
-#endif // PAGETABLE_H
\ No newline at end of file
+#endif // PAGETABLE_H
@@ -1,42 +1,484 @@
 #ifndef RING_BUFFER_H
 #define RING_BUFFER_H
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <emmintrin.h>
+#include <boost/chrono.hpp>
 #include <boost/circular_buffer.hpp>
 #include <boost/thread/mutex.hpp>
-#include <boost/thread/condition_variable.hpp>
 #include <boost/thread/locks.hpp>
 
+#include "WaitEvent.hpp"
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+/**
+ * Selects the ring buffer implementation used for inter-thread queues
+ */
+enum class RingBufferType {
+    LOCKED,     // boost::mutex around a boost::circular_buffer
+    LOCK_FREE   // SPSC/MPSC lock-free ring buffers
+};
+
+/**
+ * Common interface of all ring buffers.
+ * push/pop never block; waitPush/waitPop spin briefly and then park on a
+ * futex until the other side makes progress or the timeout expires. The
+ * spin budget adapts: it grows when spinning pays off and shrinks when the
+ * caller ends up parking anyway.
+ */
 template<typename T>
 class RingBuffer {
 public:
-    RingBuffer(size_t capacity) : buf_(capacity) {}
+    virtual ~RingBuffer() = default;
 
     bool push(const T& item) {
+        if (!tryPush(item)) {
+            return false;
+        }
+        not_empty_.notify();
+        return true;
+    }
+
+    bool pop(T& item) {
+        if (!tryPop(item)) {
+            return false;
+        }
+        not_full_.notify();
+        return true;
+    }
+
+    /**
+     * Push up to count items in order
+     * @param items Items to push
+     * @param count Number of items available
+     * @return Number of items actually pushed (a prefix of items)
+     */
+    size_t pushBatch(const T* items, size_t count) {
+        size_t pushed = tryPushBatch(items, count);
+        if (pushed > 0) {
+            not_empty_.notify();
+        }
+        return pushed;
+    }
+
+    /**
+     * Pop up to max_count items in order
+     * @param items Output array with room for max_count items
+     * @param max_count Maximum number of items to pop
+     * @return Number of items actually popped
+     */
+    size_t popBatch(T* items, size_t max_count) {
+        size_t popped = tryPopBatch(items, max_count);
+        if (popped > 0) {
+            not_full_.notify();
+        }
+        return popped;
+    }
+
+    /**
+     * Push an item, waiting up to timeout for free space
+     * @return true if the item was pushed
+     */
+    bool waitPush(const T& item, boost::chrono::nanoseconds timeout) {
+        return waitPushBatch(&item, 1, timeout) == 1;
+    }
+
+    /**
+     * Pop an item, waiting up to timeout for one to arrive
+     * @return true if an item was popped
+     */
+    bool waitPop(T& item, boost::chrono::nanoseconds timeout) {
+        return waitPopBatch(&item, 1, timeout) == 1;
+    }
+
+    /**
+     * Push up to count items, waiting up to timeout until at least one fits
+     * @return Number of items actually pushed (a prefix of items)
+     */
+    size_t waitPushBatch(const T* items, size_t count, boost::chrono::nanoseconds timeout) {
+        return waitFor(not_full_, push_spin_, timeout, [&] { return pushBatch(items, count); });
+    }
+
+    /**
+     * Pop up to max_count items, waiting up to timeout until at least one arrives
+     * @return Number of items actually popped
+     */
+    size_t waitPopBatch(T* items, size_t max_count, boost::chrono::nanoseconds timeout) {
+        return waitFor(not_empty_, pop_spin_, timeout, [&] { return popBatch(items, max_count); });
+    }
+
+    /**
+     * Number of queued items, for monitoring only: exact when neither side
+     * is active, otherwise a value the queue held while size() ran
+     */
+    virtual size_t size() const = 0;
+
+protected:
+    virtual bool tryPush(const T& item) = 0;
+    virtual bool tryPop(T& item) = 0;
+
+    virtual size_t tryPushBatch(const T* items, size_t count) {
+        size_t pushed = 0;
+        while (pushed < count && tryPush(items[pushed])) {
+            pushed++;
+        }
+        return pushed;
+    }
+
+    virtual size_t tryPopBatch(T* items, size_t max_count) {
+        size_t popped = 0;
+        while (popped < max_count && tryPop(items[popped])) {
+            popped++;
+        }
+        return popped;
+    }
+
+private:
+    static constexpr size_t MIN_SPIN = 16;
+    static constexpr size_t MAX_SPIN = 4096;
+
+    template<typename Op>
+    size_t waitFor(WaitEvent& event, std::atomic<size_t>& spin_budget, boost::chrono::nanoseconds timeout, Op op) {
+        // Spin phase: cheap retries while the other side is likely to make progress soon
+        size_t budget = spin_budget.load(std::memory_order_relaxed);
+        for (size_t i = 0; i <= budget; ++i) {
+            if (size_t n = op()) {
+                spin_budget.store(std::min(budget * 2, MAX_SPIN), std::memory_order_relaxed);
+                return n;
+            }
+            _mm_pause();
+        }
+        spin_budget.store(std::max(budget / 2, MIN_SPIN), std::memory_order_relaxed);
+
+        // Park phase: sleep on the futex until notified or the deadline passes
+        auto deadline = boost::chrono::steady_clock::now() + timeout;
+        while (true) {
+            uint32_t generation = event.prepareWait();
+            if (size_t n = op()) {
+                event.cancelWait();
+                return n;
+            }
+            auto now = boost::chrono::steady_clock::now();
+            if (now >= deadline) {
+                event.cancelWait();
+                return 0;
+            }
+            event.wait(generation, deadline - now);
+        }
+    }
+
+    alignas(CACHE_LINE_SIZE) WaitEvent not_empty_;     // Consumers park here
+    std::atomic<size_t> pop_spin_{ MIN_SPIN };
+    alignas(CACHE_LINE_SIZE) WaitEvent not_full_;      // Producers park here
+    std::atomic<size_t> push_spin_{ MIN_SPIN };
+};
+
+/**
+ * Mutex-guarded ring buffer, safe for any number of producers and consumers
+ */
+template<typename T>
+class LockedRingBuffer : public RingBuffer<T> {
+public:
+    LockedRingBuffer(size_t capacity) : buf_(capacity) {}
+
+    size_t size() const override {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        return buf_.size();
+    }
+
+protected:
+    bool tryPush(const T& item) override {
         boost::unique_lock<boost::mutex> lock(mutex_);
         if (buf_.full()) {
             return false;
         }
         buf_.push_back(item);
-        not_empty_.notify_one();
         return true;
     }
 
-    bool pop(T& item) {
+    bool tryPop(T& item) override {
         boost::unique_lock<boost::mutex> lock(mutex_);
         if (buf_.empty()) {
             return false;
         }
         item = buf_.front();
         buf_.pop_front();
-        not_full_.notify_one();
         return true;
     }
 
+    size_t tryPushBatch(const T* items, size_t count) override {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        size_t pushed = 0;
+        while (pushed < count && !buf_.full()) {
+            buf_.push_back(items[pushed++]);
+        }
+        return pushed;
+    }
+
+    size_t tryPopBatch(T* items, size_t max_count) override {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        size_t popped = 0;
+        while (popped < max_count && !buf_.empty()) {
+            items[popped++] = buf_.front();
+            buf_.pop_front();
+        }
+        return popped;
+    }
+
 private:
     boost::circular_buffer<T> buf_;
     mutable boost::mutex mutex_;
-    boost::condition_variable not_full_;
-    boost::condition_variable not_empty_;
 };
 
+/**
+ * Round a requested capacity up to the next power of two
+ * @param n Requested capacity
+ * @return Smallest power of two >= n (at least 1)
+ */
+inline size_t roundUpPowerOfTwo(size_t n) {
+    size_t capacity = 1;
+    while (capacity < n) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+/**
+ * Single-producer single-consumer lock-free ring buffer.
+ * Head and tail live on separate cache lines; each side keeps a cached copy
+ * of the other side's index so it only touches the shared line when needed.
+ */
+template<typename T>
+class SpscRingBuffer : public RingBuffer<T> {
+public:
+    SpscRingBuffer(size_t capacity)
+        : slots_(roundUpPowerOfTwo(capacity)), mask_(slots_.size() - 1) {
+    }
+
+    size_t size() const override {
+        // Head first: the tail only grows past it
+        size_t head = head_.load(std::memory_order_acquire);
+        return std::min(tail_.load(std::memory_order_acquire) - head, mask_ + 1);
+    }
+
+protected:
+    bool tryPush(const T& item) override {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cached_head_ > mask_) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail - cached_head_ > mask_) {
+                return false;
+            }
+        }
+        slots_[tail & mask_] = item;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& item) override {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cached_tail_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head == cached_tail_) {
+                return false;
+            }
+        }
+        item = slots_[head & mask_];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t tryPushBatch(const T* items, size_t count) override {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t free_slots = mask_ + 1 - (tail - cached_head_);
+        if (free_slots < count) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            free_slots = mask_ + 1 - (tail - cached_head_);
+        }
+        size_t n = std::min(count, free_slots);
+        for (size_t i = 0; i < n; ++i) {
+            slots_[(tail + i) & mask_] = items[i];
+        }
+        if (n > 0) {
+            tail_.store(tail + n, std::memory_order_release);
+        }
+        return n;
+    }
+
+    size_t tryPopBatch(T* items, size_t max_count) override {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (cached_tail_ - head < max_count) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+        }
+        size_t n = std::min(max_count, cached_tail_ - head);
+        for (size_t i = 0; i < n; ++i) {
+            items[i] = slots_[(head + i) & mask_];
+        }
+        if (n > 0) {
+            head_.store(head + n, std::memory_order_release);
+        }
+        return n;
+    }
+
+private:
+    std::vector<T> slots_;
+    const size_t mask_;
+
+    // Consumer side
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> head_{ 0 };
+    size_t cached_tail_ = 0;
+
+    // Producer side
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail_{ 0 };
+    size_t cached_head_ = 0;
+};
+
+/**
+ * Multi-producer single-consumer lock-free ring buffer.
+ * Every slot carries a sequence number (Vyukov's bounded queue): producers
+ * claim a slot by CAS on the tail and publish it by bumping the slot
+ * sequence, the single consumer never needs a read-modify-write.
+ */
+template<typename T>
+class MpscRingBuffer : public RingBuffer<T> {
+public:
+    MpscRingBuffer(size_t capacity)
+        : slots_(roundUpPowerOfTwo(capacity)), mask_(slots_.size() - 1) {
+        for (size_t i = 0; i < slots_.size(); ++i) {
+            slots_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    size_t size() const override {
+        // Counts slots claimed by producers even if not yet published
+        size_t head = head_.load(std::memory_order_acquire);
+        return std::min(tail_.load(std::memory_order_acquire) - head, mask_ + 1);
+    }
+
+protected:
+    bool tryPush(const T& item) override {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &slots_[pos & mask_];
+            size_t seq = slot->seq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if (diff < 0) {
+                return false;   // Slot still holds an unconsumed item: full
+            }
+            else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+        slot->value = item;
+        slot->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& item) override {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        Slot& slot = slots_[pos & mask_];
+        if (slot.seq.load(std::memory_order_acquire) != pos + 1) {
+            return false;
+        }
+        item = slot.value;
+        slot.seq.store(pos + mask_ + 1, std::memory_order_release);
+        head_.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    size_t tryPushBatch(const T* items, size_t count) override {
+        if (count == 0) {
+            return 0;
+        }
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        size_t n;
+        while (true) {
+            // Count the free slots starting at pos, then claim all of them with one CAS
+            n = 0;
+            while (n < count && slots_[(pos + n) & mask_].seq.load(std::memory_order_acquire) == pos + n) {
+                n++;
+            }
+            if (n == 0) {
+                intptr_t diff = static_cast<intptr_t>(slots_[pos & mask_].seq.load(std::memory_order_acquire))
+                    - static_cast<intptr_t>(pos);
+                if (diff < 0) {
+                    return 0;
+                }
+                pos = tail_.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (tail_.compare_exchange_weak(pos, pos + n, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        for (size_t i = 0; i < n; ++i) {
+            Slot& slot = slots_[(pos + i) & mask_];
+            slot.value = items[i];
+            slot.seq.store(pos + i + 1, std::memory_order_release);
+        }
+        return n;
+    }
+
+    size_t tryPopBatch(T* items, size_t max_count) override {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        size_t n = 0;
+        while (n < max_count) {
+            Slot& slot = slots_[(pos + n) & mask_];
+            if (slot.seq.load(std::memory_order_acquire) != pos + n + 1) {
+                break;
+            }
+            items[n] = slot.value;
+            slot.seq.store(pos + n + mask_ + 1, std::memory_order_release);
+            n++;
+        }
+        if (n > 0) {
+            head_.store(pos + n, std::memory_order_relaxed);
+        }
+        return n;
+    }
+
+private:
+    struct Slot {
+        std::atomic<size_t> seq{ 0 };
+        T value;
+    };
+
+    std::vector<Slot> slots_;
+    const size_t mask_;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> head_{ 0 };
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail_{ 0 };
+};
+
+/**
+ * Create a ring buffer of the requested implementation
+ * @param type Locked or lock-free implementation
+ * @param capacity Requested capacity (rounded up to a power of two when lock-free)
+ * @param multi_producer Whether more than one thread pushes into the buffer
+ * @return Owning pointer to the ring buffer
+ */
+template<typename T>
+std::unique_ptr<RingBuffer<T>> makeRingBuffer(RingBufferType type, size_t capacity, bool multi_producer) {
+    if (type == RingBufferType::LOCKED) {
+        return std::make_unique<LockedRingBuffer<T>>(capacity);
+    }
+    if (multi_producer) {
+        return std::make_unique<MpscRingBuffer<T>>(capacity);
+    }
+    return std::make_unique<SpscRingBuffer<T>>(capacity);
+}
+
 #endif // RING_BUFFER_H
@@ -2,30 +2,65 @@
 #define POLICY_CLASSIFIER_HPP
 
 #include "PageTable.hpp"
-#include "RingBuffer.hpp"
+#include "MigrationEngine.hpp"
+#include "TieringPolicy.hpp"
 #include "Common.hpp"
 
-#include <chrono>
+#include <atomic>
+#include <boost/chrono.hpp>
 
 class Server;
 
+/**
+ * Classifies pages with the tiering policy and submits move requests.
+ *
+ * The table is split into contiguous ranges, each swept by its own thread
+ * with no shared cursor, so the time to revisit a page depends on the range
+ * size rather than the table size.
+ */
 class Scanner {
 private:
+    /**
+     * Per-thread state of a range sweep
+     */
+    struct ScanRange {
+        uint32_t pass_epoch = 0;
+        uint32_t previous_pass_epoch = 0;
+        size_t reclaim_budget[NUM_PAGE_LAYERS] = { 0, 0, 0 };  // Pages each tier still has to shed in this pass
+    };
+
     PageTable& page_table_;
-    bool running_; // To control the continuous scanning process
+    MigrationEngine& migration_engine_;
+    TieringPolicy& policy_;
+    size_t num_threads_;
+    PolicyConfig policy_config_;
+    size_t num_tiers_ = 0;
+    std::atomic<bool> running_; // To control the continuous scanning process
 
-public:
-    // Constructor
-    Scanner(PageTable& page_table);
+    // Hand a move request to the migration engine, parking while its buffer is full; gives up once stopped
+    bool submitMoveRequest(const MemMoveReq& req);
+
+    // Mark a resident page as queued for target and submit its move request
+    void requestMove(size_t page_id, PageLayer target);
+
+    // Layer a page is demoted to from a fast tier
+    PageLayer demotionTarget(PageLayer layer, size_t num_tiers) const;
 
-    // Check if a single page is hot
-    bool classifyHotPage(const PageMetadata& page, size_t min_access_count) const;
+    // Start a pass over a range, sizing background demotion from the tier watermarks
+    void beginPass(ScanRange& range);
 
-    // Check if a single page is cold
-    bool classifyColdPage(const PageMetadata& page, boost::chrono::milliseconds time_threshold) const;
+    // Classify one page of a block and request, keep or cancel its move
+    void scanPage(size_t page_id, const ScanBlock& block, ScanRange& range);
+
+    // Sweep pages [begin, end) until stopped
+    void runRange(size_t begin, size_t end);
+
+public:
+    // Constructor
+    Scanner(PageTable& page_table, MigrationEngine& migration_engine, TieringPolicy& policy, size_t num_threads);
 
-    // Continuously classify pages using scanNext()
-    void runClassifier(RingBuffer<MemMoveReq>& move_page_buffer, size_t min_access_count, boost::chrono::milliseconds time_threshold, size_t num_tiers);
+    // Continuously classify pages on num_threads range threads; returns once stopped
+    void runClassifier(const PolicyConfig& policy, size_t num_tiers);
 
     // Stop the continuous classifier
     void stopClassifier();
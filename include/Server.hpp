@@ -2,43 +2,62 @@
 #define SERVER_H
 
 #include <string>
+#include <memory>
 
 #include "RingBuffer.hpp"
 #include "PageTable.hpp"
 #include "Scanner.hpp"
+#include "MigrationEngine.hpp"
+#include "TieringPolicy.hpp"
+#include "MetricsSampler.hpp"
 #include "Common.hpp"
 #include "Utils.hpp"
-#include <boost/thread/mutex.hpp>
-#include <boost/thread/lock_guard.hpp>
+#include <atomic>
 
 class Server {
 public:
-    Server(RingBuffer<ClientMessage>& client_buffer, RingBuffer<MemMoveReq>& move_page_buffer_,
-        const std::vector<size_t>& client_memory_spaces, const ServerMemoryConfig& server_config, const PolicyConfig& policy_config);
+    Server(const std::vector<size_t>& client_memory_spaces, const ServerMemoryConfig& server_config, const PolicyConfig& policy_config,
+        const ServerRuntimeConfig& runtime_config);
     ~Server();
 
     // Allocates memory in all three tiers and stores base addresses
     void allocateMemory(const ServerMemoryConfig& config);
     void generateRandomContent();
-    void handleClientMessage(const ClientMessage& msg);
-    void handleMemoryMoveRequest(const MemMoveReq& req);
-    void runManagerThread();
+    void handleClientMessage(size_t worker_id, const ClientMessage& msg);
+    void runManagerThread(size_t worker_id);
+    void printTierOccupancy() const;
     void runPolicyThread();
+    void runEpochTicker();
+    void runRecoveryMonitor();
+    void runMetricsSampler();
     void start();
 
+    // Routing information for clients: one request buffer per manager shard
+    std::vector<RingBuffer<ClientMessage>*> getClientBuffers() const;
+    const ShardMap& getShardMap() const { return shard_map_; }
+    size_t getBasePageId(size_t client_id) const { return base_page_id_[client_id]; }
+
     // Shutdown function
     void signalShutdown();  // Sets the shutdown flag
     bool shouldShutdown();  // Checks the shutdown flag
 
 private:
-    RingBuffer<ClientMessage>& client_buffer_;
-    RingBuffer<MemMoveReq>& move_page_buffer_;
+    // Per-shard request queues; worker i serves client_buffers_[i]
+    std::vector<std::unique_ptr<RingBuffer<ClientMessage>>> client_buffers_;
+    ShardMap shard_map_;
     std::vector<size_t> base_page_id_;
     PageTable* page_table_;
     Scanner* scanner_;
+    MigrationEngine* migration_engine_;
+    std::unique_ptr<TieringPolicy> tiering_policy_;
+    std::unique_ptr<MetricsSampler> metrics_sampler_;     // Null unless a metrics time series is written
     ServerMemoryConfig server_config_;
     PolicyConfig policy_config_;
-    std::vector<bool> client_done_flags_;
+    ServerRuntimeConfig runtime_config_;
+
+    // END flags of every client as seen by each worker
+    std::vector<std::vector<bool>> client_done_flags_;
+    std::atomic<size_t> finished_workers_{ 0 };
 
     // Number of pages in each tier, stored for convenience
     size_t num_tiers_ = 0;
@@ -50,8 +69,7 @@ private:
     void* remote_base_ = nullptr;
     void* pmem_base_ = nullptr;
 
-    bool shutdown_flag_ = false;    // Shared shutdown flag
-    boost::mutex shutdown_mutex_;   // Protects the flag
+    std::atomic<bool> shutdown_flag_{ false };  // Shared shutdown flag
 
 };
 
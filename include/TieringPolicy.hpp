@@ -0,0 +1,230 @@
+#ifndef TIERING_POLICY_H
+#define TIERING_POLICY_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "PageTable.hpp"
+#include "Common.hpp"
+
+/**
+ * Block of consecutive pages a scanner thread classifies at once
+ */
+struct ScanBlock {
+    static constexpr size_t MAX_PAGES = 64;
+
+    size_t begin = 0;       // First page id
+    size_t count = 0;
+    uint32_t epoch = 0;     // Current epoch, read once per block
+    ClassifyMasks masks;    // Filled by TieringPolicy::classifyBlock()
+
+    bool hot(size_t page_id) const { return (masks.hot >> (page_id - begin)) & 1; }
+    bool cold(size_t page_id) const { return (masks.cold >> (page_id - begin)) & 1; }
+};
+
+/**
+ * Decides which tier each page belongs on.
+ *
+ * Manager threads report every client access through onAccess(), which must
+ * be thread-safe and cheap. Scanner threads walk the table in blocks:
+ * classifyBlock() once per block, then onScan() for every page of it and
+ * reclaimable() to pick victims when a fast tier has to shed pages. All
+ * three may run concurrently on different blocks. Tier capacity and
+ * watermarks are enforced by the scanner, not by the policy.
+ */
+class TieringPolicy {
+public:
+    TieringPolicy(const PageTable& page_table, const PolicyConfig& config, size_t num_tiers);
+    virtual ~TieringPolicy() = default;
+
+    virtual const char* name() const = 0;
+
+    // Whether the policy reads the page table access counters; the scanner only decays them if so
+    virtual bool usesAccessCounts() const { return false; }
+
+    /**
+     * Record a client access to a page
+     * @param page_id Global page id
+     */
+    virtual void onAccess(size_t page_id) { (void)page_id; }
+
+    /**
+     * Precompute per-block state before its pages are scanned
+     * @param block Block to classify; the policy may fill its masks
+     */
+    virtual void classifyBlock(ScanBlock& block) const { (void)block; }
+
+    /**
+     * Decide whether a scanned page should move
+     * @param page_id Global page id
+     * @param page Snapshot of the page table entry
+     * @param block Block containing the page
+     * @param target Set to the destination layer when the page should move
+     * @return true if the page should move to target
+     */
+    virtual bool onScan(size_t page_id, const PageMetadata& page, const ScanBlock& block, PageLayer& target) = 0;
+
+    /**
+     * Check whether a fast tier page may be demoted to make room
+     * @param page_id Global page id
+     * @param page Snapshot of the page table entry
+     * @param pass_epoch Epoch at which the scanner's previous pass over the page started
+     * @return true if the page is a reclaim victim
+     */
+    virtual bool reclaimable(size_t page_id, const PageMetadata& page, uint32_t pass_epoch) = 0;
+
+protected:
+    // Default placement of the hot/cold rules: demote cold pages one tier
+    // down, promote hot pages one tier up (PMEM straight to DRAM with two tiers)
+    bool placeByHeat(const PageMetadata& page, bool hot, bool cold, PageLayer& target) const;
+
+    // Next slower layer below a fast tier
+    PageLayer lowerLayer(PageLayer layer) const;
+
+    const PageTable& page_table_;
+    PolicyConfig config_;
+    size_t num_tiers_;
+};
+
+/**
+ * Original policy: hot once the access count reaches hot_access_cnt,
+ * cold once idle for cold_access_interval epochs, both evaluated for a whole
+ * block by the SIMD classification kernel. Reclaims pages not accessed
+ * since the scanner's previous pass.
+ */
+class ThresholdPolicy : public TieringPolicy {
+public:
+    using TieringPolicy::TieringPolicy;
+
+    const char* name() const override { return "threshold"; }
+    bool usesAccessCounts() const override { return true; }
+    void classifyBlock(ScanBlock& block) const override;
+    bool onScan(size_t page_id, const PageMetadata& page, const ScanBlock& block, PageLayer& target) override;
+    bool reclaimable(size_t page_id, const PageMetadata& page, uint32_t pass_epoch) override;
+};
+
+/**
+ * CLOCK (second chance): an access sets the page's reference bit. A
+ * referenced page in a slow tier is promoted one tier up; a fast tier page
+ * is only demoted under pressure, and the sweep gives a referenced one a
+ * second chance by clearing its bit instead.
+ */
+class ClockPolicy : public TieringPolicy {
+public:
+    ClockPolicy(const PageTable& page_table, const PolicyConfig& config, size_t num_tiers);
+
+    const char* name() const override { return "clock"; }
+    void onAccess(size_t page_id) override;
+    bool onScan(size_t page_id, const PageMetadata& page, const ScanBlock& block, PageLayer& target) override;
+    bool reclaimable(size_t page_id, const PageMetadata& page, uint32_t pass_epoch) override;
+
+private:
+    std::unique_ptr<std::atomic<uint8_t>[]> referenced_;
+};
+
+/**
+ * LRU-K: ranks pages by the time of their K-th most recent access. A page
+ * is hot when its last K accesses fall within cold_access_interval and cold
+ * once idle for cold_access_interval.
+ */
+class LruKPolicy : public TieringPolicy {
+public:
+    static constexpr size_t K = 2;
+
+    LruKPolicy(const PageTable& page_table, const PolicyConfig& config, size_t num_tiers);
+
+    const char* name() const override { return "lru-k"; }
+    void onAccess(size_t page_id) override;
+    void classifyBlock(ScanBlock& block) const override;
+    bool onScan(size_t page_id, const PageMetadata& page, const ScanBlock& block, PageLayer& target) override;
+    bool reclaimable(size_t page_id, const PageMetadata& page, uint32_t pass_epoch) override;
+
+private:
+    // Epoch of the K-th most recent access, 0 if the page has fewer than K
+    uint32_t kthAccess(size_t page_id) const;
+
+    // Last K access epochs per page, most recent first; epochs start at 1
+    std::unique_ptr<std::atomic<uint32_t>[]> history_;
+};
+
+/**
+ * Decayed LFU: a per-page frequency counter bumped on access and halved
+ * every time the scanner passes the page, so old popularity fades. Hot at
+ * hot_access_cnt, cold once the count decayed to zero.
+ */
+class DecayedLfuPolicy : public TieringPolicy {
+public:
+    DecayedLfuPolicy(const PageTable& page_table, const PolicyConfig& config, size_t num_tiers);
+
+    const char* name() const override { return "lfu"; }
+    void onAccess(size_t page_id) override;
+    bool onScan(size_t page_id, const PageMetadata& page, const ScanBlock& block, PageLayer& target) override;
+    bool reclaimable(size_t page_id, const PageMetadata& page, uint32_t pass_epoch) override;
+
+private:
+    std::unique_ptr<std::atomic<uint32_t>[]> frequency_;
+};
+
+/**
+ * ARC (Megiddo & Modha) over the local tier: the cache of c pages is split
+ * into recency (T1) and frequency (T2) lists with ghost lists B1/B2 and an
+ * adaptive target size for T1. Pages in T1/T2 belong on NUMA_LOCAL; pages
+ * evicted from them are demoted one tier.
+ *
+ * Every manager shard runs its own ARC over its pages, with the local tier
+ * capacity split across shards in proportion to their pages. A shard's
+ * lists are only touched by the manager serving it, so onAccess() takes no
+ * lock; the scanner reads each page's list without locking.
+ */
+class ArcPolicy : public TieringPolicy {
+public:
+    ArcPolicy(const PageTable& page_table, const PolicyConfig& config, size_t num_tiers, const ShardMap& shard_map);
+
+    const char* name() const override { return "arc"; }
+    void onAccess(size_t page_id) override;
+    bool onScan(size_t page_id, const PageMetadata& page, const ScanBlock& block, PageLayer& target) override;
+    bool reclaimable(size_t page_id, const PageMetadata& page, uint32_t pass_epoch) override;
+
+private:
+    enum ListId : uint8_t { NONE, T1, T2, B1, B2, NUM_LISTS };
+
+    /**
+     * Intrusive doubly linked list of page ids, MRU at the head
+     */
+    struct PageList {
+        size_t head = SIZE_MAX;
+        size_t tail = SIZE_MAX;
+        size_t size = 0;
+    };
+
+    /**
+     * ARC state of one manager shard
+     */
+    struct Shard {
+        size_t capacity = 0;    // c: local tier pages granted to the shard
+        size_t target_t1 = 0;   // p: adaptive target size of T1
+        PageList lists[NUM_LISTS];
+    };
+
+    void pushFront(Shard& shard, ListId list, size_t page_id);
+    void remove(Shard& shard, size_t page_id);
+    size_t popBack(Shard& shard, ListId list);
+    void replace(Shard& shard, bool in_b2);
+    bool inCache(size_t page_id) const;
+
+    ShardMap shard_map_;
+    std::vector<Shard> shards_;
+    std::vector<size_t> prev_;
+    std::vector<size_t> next_;
+    std::unique_ptr<std::atomic<uint8_t>[]> list_of_;   // ListId of each page
+};
+
+/**
+ * Create the tiering policy of the given type
+ */
+std::unique_ptr<TieringPolicy> makeTieringPolicy(TieringPolicyType type, const PageTable& page_table,
+    const PolicyConfig& config, size_t num_tiers, const ShardMap& shard_map);
+
+#endif // TIERING_POLICY_H
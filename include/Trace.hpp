@@ -0,0 +1,159 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "Common.hpp"
+
+/**
+ * Binary memory access trace: a TraceHeader followed by record_count
+ * records in the header's encoding. All fields are little endian.
+ */
+struct TraceHeader {
+    static constexpr char MAGIC[8] = { 'M', 'T', 'T', 'R', 'A', 'C', 'E', '\0' };
+    static constexpr uint32_t VERSION = 1;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t encoding;          // TraceEncoding of the records
+    uint64_t record_count;
+};
+
+static_assert(sizeof(TraceHeader) == 24, "TraceHeader is an on-disk format");
+
+/**
+ * Record layouts a trace may use
+ */
+enum class TraceEncoding : uint32_t {
+    FIXED = 0,          // TraceRecord as is, 16 bytes per access
+    VARINT_DELTA = 1    // LEB128 varints, see TraceWriter; 2-4 bytes per access
+};
+
+/**
+ * One access of a trace, also the on-disk record of TraceEncoding::FIXED
+ */
+struct TraceRecord {
+    uint64_t offset = 0;        // Page offset within the client's address space
+    uint32_t delta_us = 0;      // Time since the previous record of the trace
+    uint16_t client_id = 0;
+    uint8_t op = 0;             // 0 read, 1 write
+    uint8_t reserved = 0;
+};
+
+static_assert(sizeof(TraceRecord) == 16, "TraceRecord is an on-disk format");
+
+/**
+ * Sequential reader of a memory-mapped trace file. Records are decoded in
+ * place from the mapping, so replay allocates nothing per record.
+ */
+class TraceReader {
+public:
+    /**
+     * Map a trace file and validate its header
+     * @param path Trace file
+     * @return Reader positioned at the first record, nullptr if the file is missing or not a trace
+     */
+    static std::unique_ptr<TraceReader> open(const std::string& path);
+
+    ~TraceReader();
+    TraceReader(const TraceReader&) = delete;
+    TraceReader& operator=(const TraceReader&) = delete;
+
+    /**
+     * Decode the next record
+     * @param record Receives the record
+     * @return false once the trace is exhausted
+     */
+    bool next(TraceRecord& record);
+
+    uint64_t recordCount() const { return header_.record_count; }
+    TraceEncoding encoding() const { return static_cast<TraceEncoding>(header_.encoding); }
+
+private:
+    TraceReader(const uint8_t* data, size_t size, const TraceHeader& header);
+
+    // Decode one LEB128 varint, false if it runs past the end of the file
+    bool readVarint(uint64_t& value);
+
+    const uint8_t* data_;       // Whole mapped file
+    size_t size_;
+    TraceHeader header_;
+    size_t position_;           // Byte position of the next record
+    uint64_t records_read_ = 0;
+    TraceRecord previous_;      // Base of the VARINT_DELTA deltas
+};
+
+/**
+ * Records an access stream to a trace file in TraceEncoding::VARINT_DELTA.
+ * Each record is a varint of zigzag(offset - previous offset) << 2 | op << 1
+ * | client changed, the client id as a varint if it changed, then delta_us
+ * as a varint.
+ *
+ * append() only encodes into an in-memory buffer; full buffers are handed to
+ * a background thread that writes them out, so the recording thread never
+ * waits for the disk. The record count is patched into the header on close().
+ */
+class TraceWriter {
+public:
+    static constexpr size_t BUFFER_SIZE = 1 << 20;
+
+    /**
+     * Create a trace file and start its writer thread
+     * @param path Trace file, truncated if it exists
+     * @return Writer, nullptr if the file cannot be created
+     */
+    static std::unique_ptr<TraceWriter> open(const std::string& path);
+
+    ~TraceWriter();
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    /**
+     * Append one access; called by a single thread
+     * @param record Access to record
+     */
+    void append(const TraceRecord& record);
+
+    // Write out buffered records, stop the writer thread and finish the header
+    void close();
+
+private:
+    TraceWriter(int fd, const std::string& path);
+
+    // Hand the active buffer to the writer thread and take an empty one
+    void submitBuffer();
+    void runWriter();
+
+    static void writeVarint(uint8_t*& out, uint64_t value) {
+        while (value >= 0x80) {
+            *out++ = static_cast<uint8_t>(value | 0x80);
+            value >>= 7;
+        }
+        *out++ = static_cast<uint8_t>(value);
+    }
+
+    int fd_;
+    std::string path_;
+    uint64_t record_count_ = 0;
+    TraceRecord previous_;
+    std::vector<uint8_t> active_;       // Buffer being filled by append()
+    size_t active_size_ = 0;
+
+    // Buffers in flight between append() and the writer thread
+    std::deque<std::vector<uint8_t>> full_;
+    std::vector<std::vector<uint8_t>> free_;
+    bool closing_ = false;
+    boost::mutex mutex_;
+    boost::condition_variable cond_;
+    boost::thread writer_thread_;
+};
+
+#endif // TRACE_H
@@ -14,6 +14,8 @@
 #include <emmintrin.h>
 #include <string.h>
 
+#include "Common.hpp"
+
 //======================================
 // Constants and Configurations
 //======================================
@@ -134,24 +136,6 @@ inline void* allocate_and_bind_to_numa(size_t size, size_t number, int numa_node
 // Page Migration
 //======================================
 
-/**
- * Move a single page to specified NUMA node
- * @param addr Page address
- * @param target_node Target NUMA node
- */
-inline uint64_t move_page_to_node(void* addr, int target_node) {
-    void* pages[1] = { addr };
-    int nodes[1] = { target_node };
-    int status[1];
-
-    uint64_t start_time = get_time_ns();
-    if (syscall(SYS_move_pages, 0, 1, pages, nodes, status, MPOL_MF_MOVE) != 0) {
-        perror("move_pages failed");
-        exit(EXIT_FAILURE);
-    }
-    return (get_time_ns() - start_time);
-}
-
 /**
  * Move multiple pages to specified NUMA node
  * @param addr Starting address of pages
@@ -199,15 +183,33 @@ inline void move_pages_to_node(void* addr, size_t size, size_t number, int targe
 }
 
 /**
- * Migrate a page between memory tiers
- * @param addr Page address
- * @param current_tier Current memory tier
- * @param target_tier Target memory tier
+ * Move a batch of pages with a single move_pages call
+ * @param pages Page addresses
+ * @param nodes Target NUMA node of each page
+ * @param status Per-page result: node the page resides on afterwards, or a negative errno
+ * @param count Number of pages
+ * @return Time spent in the syscall in nanoseconds
+ */
+inline uint64_t move_pages_batch(void** pages, const int* nodes, int* status, size_t count) {
+    uint64_t start_time = get_time_ns();
+    if (syscall(SYS_move_pages, 0, count, pages, nodes, status, MPOL_MF_MOVE) < 0) {
+        int err = errno;    // perror() may overwrite errno
+        perror("move_pages failed");
+        for (size_t i = 0; i < count; i++) {
+            status[i] = -err;
+        }
+    }
+    return (get_time_ns() - start_time);
+}
+
+/**
+ * NUMA node backing a memory tier
+ * @param tier Memory tier
+ * @return NUMA node id
  */
-inline uint64_t migrate_page(void* addr, PageLayer current_tier, PageLayer target_tier) {
-    int target_node = (target_tier == PageLayer::NUMA_LOCAL) ? 0 :
-        (target_tier == PageLayer::NUMA_REMOTE) ? 1 : 2;
-    return move_page_to_node(addr, target_node);
+inline int tier_to_node(PageLayer tier) {
+    return (tier == PageLayer::NUMA_LOCAL) ? 0 :
+        (tier == PageLayer::NUMA_REMOTE) ? 1 : 2;
 }
 
 //======================================
@@ -0,0 +1,69 @@
+#ifndef WAIT_EVENT_H
+#define WAIT_EVENT_H
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <boost/chrono.hpp>
+
+/**
+ * Futex-backed event that lets a thread park until another thread signals progress.
+ *
+ * Waiting protocol: prepareWait(), re-check the condition, then wait() or
+ * cancelWait(). notify() costs a fence and a load when nobody is parked.
+ */
+class WaitEvent {
+public:
+    /**
+     * Announce that the caller is about to park
+     * @return Generation to hand to wait()
+     */
+    uint32_t prepareWait() {
+        waiters_.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return generation_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Park until notified, the timeout expires or the generation moved on
+     * @param generation Value returned by prepareWait()
+     * @param timeout Maximum time to park
+     */
+    void wait(uint32_t generation, boost::chrono::nanoseconds timeout) {
+        struct timespec ts;
+        ts.tv_sec = timeout.count() / 1000000000LL;
+        ts.tv_nsec = timeout.count() % 1000000000LL;
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&generation_), FUTEX_WAIT_PRIVATE,
+            generation, &ts, nullptr, 0);
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * Withdraw from prepareWait() because the condition became true
+     */
+    void cancelWait() {
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * Wake every parked thread; call after publishing the change they wait for
+     */
+    void notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters_.load(std::memory_order_relaxed) > 0) {
+            generation_.fetch_add(1, std::memory_order_release);
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&generation_), FUTEX_WAKE_PRIVATE,
+                INT_MAX, nullptr, nullptr, 0);
+        }
+    }
+
+private:
+    std::atomic<uint32_t> generation_{ 0 };
+    std::atomic<uint32_t> waiters_{ 0 };
+};
+
+#endif // WAIT_EVENT_H
@@ -15,30 +15,41 @@ int main(int argc, char* argv[]) {
         return config.isHelpRequested() ? 0 : 1;
     }
 
-    RingBuffer<ClientMessage> client_req_buffer(config.getBufferSize());
     std::vector<size_t> memory_sizes;
     const auto& client_configs = config.getClientConfigs();
     for (const auto& client_config : client_configs) {
         memory_sizes.push_back(client_config.addr_space_size);
     }
 
-    RingBuffer<MemMoveReq> move_page_buffer(config.getBufferSize());
     ServerMemoryConfig server_config = config.getServerMemoryConfig();
     PolicyConfig policy_config = config.getPolicyConfig();
-    Server server(client_req_buffer, move_page_buffer, memory_sizes, server_config, policy_config);
+    ServerRuntimeConfig runtime_config = config.getServerRuntimeConfig();
+    Server server(memory_sizes, server_config, policy_config, runtime_config);
 
     std::vector<std::shared_ptr<Client>> clients;
-    std::vector<boost::thread> client_threads;
     for (size_t i = 0; i < client_configs.size(); i++) {
         const auto& client_config = client_configs[i];
         auto client = std::make_shared<Client>(
-            client_req_buffer,
+            server.getClientBuffers(),
+            server.getShardMap(),
+            server.getBasePageId(i),
             i,
             config.getMessageCount(),
             client_config.addr_space_size,
-            client_config.pattern
+            client_config.pattern,
+            runtime_config.batch_size,
+            config.getLoadConfig(),
+            config.getRecordTracePrefix().empty() ? ""
+                : config.getRecordTracePrefix() + "." + std::to_string(i) + ".trace"
         );
+        if (!client->ready()) {
+            return 1;
+        }
         clients.push_back(client);
+    }
+
+    std::vector<boost::thread> client_threads;
+    for (const auto& client : clients) {
         client_threads.emplace_back([client]() { client->run(); });
     }
 
@@ -0,0 +1,90 @@
+"""Convert a text or CSV memory access trace to the binary trace format
+replayed with `-p trace:FILE`.
+
+Each input line holds `client_id,offset,op[,timestamp]`, separated by commas
+or whitespace. `op` is R/READ/0 or W/WRITE/1 (case insensitive). The
+optional timestamp is absolute; it is stored as the delta to the previous
+line for paced replay (`-p trace:FILE@paced`). Blank lines, lines starting
+with '#' and a header line are skipped.
+
+Usage: python3 convert_trace.py input.csv output.trace [--time-unit us]
+"""
+import argparse
+import re
+import struct
+import sys
+
+MAGIC = b"MTTRACE\0"
+VERSION = 1
+ENCODING_FIXED = 0
+
+HEADER = struct.Struct("<8sIIQ")    # magic, version, encoding, record_count
+RECORD = struct.Struct("<QIHBB")    # offset, delta_us, client_id, op, reserved
+
+# Microseconds per input timestamp unit
+TIME_UNITS = {"ns": 1e-3, "us": 1.0, "ms": 1e3, "s": 1e6}
+
+OPS = {"r": 0, "read": 0, "0": 0, "w": 1, "write": 1, "1": 1}
+
+
+def parse_line(line, line_no):
+    fields = [f for f in re.split(r"[,\s]+", line.strip()) if f]
+    if len(fields) not in (3, 4):
+        raise ValueError(f"line {line_no}: expected client_id,offset,op[,timestamp]")
+    client_id = int(fields[0])
+    offset = int(fields[1], 0)
+    op = OPS.get(fields[2].lower())
+    if op is None:
+        raise ValueError(f"line {line_no}: unknown op '{fields[2]}'")
+    timestamp = float(fields[3]) if len(fields) == 4 else None
+    if not 0 <= client_id < 1 << 16 or offset < 0:
+        raise ValueError(f"line {line_no}: client id or offset out of range")
+    return client_id, offset, op, timestamp
+
+
+def convert(src, dst, time_unit):
+    scale = TIME_UNITS[time_unit]
+    count = 0
+    previous_us = None     # Previous timestamp in whole microseconds
+    dst.write(HEADER.pack(MAGIC, VERSION, ENCODING_FIXED, 0))
+    for line_no, line in enumerate(src, 1):
+        if not line.strip() or line.lstrip().startswith("#"):
+            continue
+        try:
+            client_id, offset, op, timestamp = parse_line(line, line_no)
+        except ValueError:
+            if count == 0 and line_no == 1:
+                continue    # Header line
+            raise
+        delta_us = 0
+        if timestamp is not None:
+            # Round the absolute time, not each gap, so sub-microsecond gaps
+            # add up instead of all rounding to 0
+            timestamp_us = int(round(timestamp * scale))
+            if previous_us is not None:
+                delta_us = min(max(timestamp_us - previous_us, 0), 0xFFFFFFFF)
+            previous_us = timestamp_us
+        dst.write(RECORD.pack(offset, delta_us, client_id, op, 0))
+        count += 1
+    # Patch the record count into the header
+    dst.seek(0)
+    dst.write(HEADER.pack(MAGIC, VERSION, ENCODING_FIXED, count))
+    return count
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert a text/CSV trace to the binary trace format")
+    parser.add_argument("input", help="text or CSV trace, '-' for stdin")
+    parser.add_argument("output", help="binary trace file to write")
+    parser.add_argument("--time-unit", choices=sorted(TIME_UNITS), default="us",
+                        help="unit of the input timestamps (default us)")
+    args = parser.parse_args()
+
+    src = sys.stdin if args.input == "-" else open(args.input)
+    with src, open(args.output, "wb") as dst:
+        count = convert(src, dst, args.time_unit)
+    print(f"Wrote {count} records to {args.output}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,63 @@
+import subprocess
+import re
+import statistics
+import csv
+
+# Manager worker counts to compare
+worker_counts = [1, 2, 4, 8]
+
+# Number of iterations for each worker count
+num_iterations = 5
+
+# Define the command to run the benchmark (run from the scripts directory)
+base_command = [
+    "../build/main",
+    "-p", "uniform,skewed,uniform",
+    "-c", "1000,2000,1500",
+    "-b", "1024",
+    "-m", "1000000",
+    "-t", "3",
+    "-s", "1280,5120,21480",
+    "--hot-access-cnt", "10",
+    "--cold-access-interval", "1000",
+]
+
+# CSV file to store results
+csv_file = "scaling_results.csv"
+
+# Wall-clock rate printed by the server when all clients are done
+pattern = re.compile(r"Wall-clock:\s+([\d.e+]+) ops/sec")
+
+results = {workers: [] for workers in worker_counts}
+
+for workers in worker_counts:
+    command = base_command + ["--manager-threads", str(workers)]
+    for i in range(num_iterations):
+        try:
+            output = subprocess.check_output(command, text=True, stderr=subprocess.STDOUT,
+                                             env={"LOG_LEVEL": "info"})
+            match = pattern.search(output)
+            if match:
+                results[workers].append(float(match.group(1)))
+        except subprocess.CalledProcessError as e:
+            print(f"Error with {workers} workers, iteration {i + 1}: {e}")
+        except Exception as ex:
+            print(f"Unexpected error: {ex}")
+
+# Compute and display the average results
+print("\n--- Manager Scaling (ops/sec, wall clock) ---")
+with open(csv_file, "w", newline="") as f:
+    writer = csv.writer(f)
+    writer.writerow(["ManagerThreads", "MeanOpsPerSec", "StdevOpsPerSec", "Speedup"])
+    baseline = None
+    for workers, values in results.items():
+        if not values:
+            print(f"{workers} workers: No data collected")
+            continue
+        avg = statistics.mean(values)
+        stdev = statistics.stdev(values) if len(values) > 1 else 0.0
+        baseline = baseline or avg
+        print(f"{workers} workers: {avg:.0f} ops/sec (x{avg / baseline:.2f})")
+        writer.writerow([workers, f"{avg:.0f}", f"{stdev:.0f}", f"{avg / baseline:.2f}"])
+
+print(f"Results are in {csv_file}.")
@@ -0,0 +1,129 @@
+#include "ClassifyKernel.hpp"
+
+#include <immintrin.h>
+
+static void classifyScalar(const uint32_t* counts, const uint32_t* epochs, size_t count,
+    uint32_t hot_threshold, uint32_t cold_before, ClassifyMasks& masks) {
+    uint64_t hot = 0;
+    uint64_t cold = 0;
+    for (size_t i = 0; i < count; ++i) {
+        hot |= static_cast<uint64_t>(counts[i] >= hot_threshold) << i;
+        cold |= static_cast<uint64_t>(epochs[i] < cold_before) << i;
+    }
+    masks.hot = hot;
+    masks.cold = cold;
+}
+
+// There is no unsigned compare before AVX-512, so a >= b is tested as max(a, b) == a
+
+__attribute__((target("sse4.1")))
+static void classifySse41(const uint32_t* counts, const uint32_t* epochs, size_t count,
+    uint32_t hot_threshold, uint32_t cold_before, ClassifyMasks& masks) {
+    const __m128i hot_limit = _mm_set1_epi32(static_cast<int>(hot_threshold));
+    const __m128i cold_limit = _mm_set1_epi32(static_cast<int>(cold_before));
+    uint64_t hot = 0;
+    uint64_t warm = 0;  // Complement of cold
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(counts + i));
+        __m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(epochs + i));
+        __m128i is_hot = _mm_cmpeq_epi32(_mm_max_epu32(c, hot_limit), c);
+        __m128i is_warm = _mm_cmpeq_epi32(_mm_max_epu32(e, cold_limit), e);
+        hot |= static_cast<uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(is_hot))) << i;
+        warm |= static_cast<uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(is_warm))) << i;
+    }
+    uint64_t cold = ~warm & ((i == 64) ? ~0ULL : ((1ULL << i) - 1));
+
+    ClassifyMasks tail;
+    classifyScalar(counts + i, epochs + i, count - i, hot_threshold, cold_before, tail);
+    masks.hot = hot | (tail.hot << (i & 63));
+    masks.cold = cold | (tail.cold << (i & 63));
+}
+
+__attribute__((target("avx2")))
+static void classifyAvx2(const uint32_t* counts, const uint32_t* epochs, size_t count,
+    uint32_t hot_threshold, uint32_t cold_before, ClassifyMasks& masks) {
+    const __m256i hot_limit = _mm256_set1_epi32(static_cast<int>(hot_threshold));
+    const __m256i cold_limit = _mm256_set1_epi32(static_cast<int>(cold_before));
+    uint64_t hot = 0;
+    uint64_t warm = 0;  // Complement of cold
+
+    // Two registers per iteration: 16 pages
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i c0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(counts + i));
+        __m256i c1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(counts + i + 8));
+        __m256i e0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(epochs + i));
+        __m256i e1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(epochs + i + 8));
+        __m256i hot0 = _mm256_cmpeq_epi32(_mm256_max_epu32(c0, hot_limit), c0);
+        __m256i hot1 = _mm256_cmpeq_epi32(_mm256_max_epu32(c1, hot_limit), c1);
+        __m256i warm0 = _mm256_cmpeq_epi32(_mm256_max_epu32(e0, cold_limit), e0);
+        __m256i warm1 = _mm256_cmpeq_epi32(_mm256_max_epu32(e1, cold_limit), e1);
+        uint64_t hot_bits = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(hot0)))
+            | (static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(hot1))) << 8);
+        uint64_t warm_bits = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(warm0)))
+            | (static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(warm1))) << 8);
+        hot |= hot_bits << i;
+        warm |= warm_bits << i;
+    }
+    uint64_t cold = ~warm & ((i == 64) ? ~0ULL : ((1ULL << i) - 1));
+
+    ClassifyMasks tail;
+    classifyScalar(counts + i, epochs + i, count - i, hot_threshold, cold_before, tail);
+    masks.hot = hot | (tail.hot << (i & 63));
+    masks.cold = cold | (tail.cold << (i & 63));
+}
+
+ClassifyKernelFn classifyKernel(ClassifyIsa isa) {
+    switch (isa) {
+    case ClassifyIsa::AVX2:
+        return classifyAvx2;
+    case ClassifyIsa::SSE41:
+        return classifySse41;
+    case ClassifyIsa::SCALAR:
+    default:
+        return classifyScalar;
+    }
+}
+
+bool classifyIsaSupported(ClassifyIsa isa) {
+    __builtin_cpu_init();
+    switch (isa) {
+    case ClassifyIsa::AVX2:
+        return __builtin_cpu_supports("avx2");
+    case ClassifyIsa::SSE41:
+        return __builtin_cpu_supports("sse4.1");
+    case ClassifyIsa::SCALAR:
+    default:
+        return true;
+    }
+}
+
+ClassifyIsa bestClassifyIsa() {
+    if (classifyIsaSupported(ClassifyIsa::AVX2)) {
+        return ClassifyIsa::AVX2;
+    }
+    if (classifyIsaSupported(ClassifyIsa::SSE41)) {
+        return ClassifyIsa::SSE41;
+    }
+    return ClassifyIsa::SCALAR;
+}
+
+const char* classifyIsaName(ClassifyIsa isa) {
+    switch (isa) {
+    case ClassifyIsa::AVX2:
+        return "avx2";
+    case ClassifyIsa::SSE41:
+        return "sse4.1";
+    case ClassifyIsa::SCALAR:
+    default:
+        return "scalar";
+    }
+}
+
+void classifyPages(const uint32_t* counts, const uint32_t* epochs, size_t count,
+    uint32_t hot_threshold, uint32_t cold_before, ClassifyMasks& masks) {
+    static const ClassifyKernelFn kernel = classifyKernel(bestClassifyIsa());
+    kernel(counts, epochs, count, hot_threshold, cold_before, masks);
+}
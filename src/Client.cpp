@@ -1,33 +1,166 @@
 #include "Client.hpp"
 #include "Logger.hpp"
+#include "Metrics.hpp"
+#include "Utils.hpp"
 
 #include <iostream>
+#include <vector>
 #include <boost/chrono.hpp>
-#include <boost/thread/thread.hpp> 
+#include <boost/thread/thread.hpp>
 
-Client::Client(RingBuffer<ClientMessage>& buffer, size_t client_id, size_t message_cnt, size_t memory_space, AccessPattern pattern)
-    : buffer_(buffer),
+Client::Client(const std::vector<RingBuffer<ClientMessage>*>& buffers, const ShardMap& shard_map, size_t base_page_id,
+    size_t client_id, size_t message_cnt, size_t memory_space, const AccessPatternConfig& pattern, size_t batch_size,
+    const LoadConfig& load, const std::string& record_path)
+    : buffers_(buffers),
+    shard_map_(shard_map),
+    base_page_id_(base_page_id),
     client_id_(client_id),
     message_cnt_(message_cnt),
-    generator_(pattern, memory_space) {
+    batch_size_(batch_size),
+    memory_space_(memory_space),
+    generator_(pattern, memory_space),
+    load_(load),
+    batches_(buffers.size()) {
+    for (auto& batch : batches_) {
+        batch.reserve(batch_size_);
+    }
+    if (pattern.type == AccessPattern::TRACE) {
+        replay_ = true;
+        trace_ = TraceReader::open(pattern.trace_path);
+        trace_paced_ = pattern.trace_paced;
+    }
+    if (!record_path.empty()) {
+        recorder_ = TraceWriter::open(record_path);
+    }
 }
 
-void Client::run() {
-    for (size_t i = 0; i < message_cnt_; ++i) {
-        size_t offset = generator_.generateOffset();
-        OperationType op = (i % 2 == 0) ? OperationType::READ : OperationType::WRITE;
+void Client::sendBatch(size_t shard, ClientMessage* msgs, size_t count) {
+    // Queue wait starts here, including any wait for room in a full buffer
+    uint64_t now = get_time_ns();
+    for (size_t i = 0; i < count; ++i) {
+        msgs[i].enqueue_ns = now;
+    }
+    size_t sent = 0;
+    while (sent < count) {
+        // Parks on the buffer while it is full instead of sleep-polling
+        sent += buffers_[shard]->waitPushBatch(msgs + sent, count - sent, boost::chrono::milliseconds(1));
+    }
+}
+
+void Client::queueMessage(size_t offset, OperationType op, uint64_t intended_ns) {
+    // Messages are batched per shard, each batch goes to the manager owning its pages
+    size_t shard = shard_map_.shardOf(base_page_id_ + offset);
+    std::vector<ClientMessage>& batch = batches_[shard];
+    batch.emplace_back(client_id_, offset, op, intended_ns);
+    LOG_DEBUG("Client sent: " << batch.back().toString());
+
+    if (recorder_) {
+        TraceRecord record;
+        uint64_t now_us = boost::chrono::duration_cast<boost::chrono::microseconds>(
+            boost::chrono::steady_clock::now() - start_).count();
+        record.offset = offset;
+        record.delta_us = static_cast<uint32_t>(now_us - recorded_us_);
+        record.client_id = static_cast<uint16_t>(client_id_);
+        record.op = (op == OperationType::WRITE) ? 1 : 0;
+        recorder_->append(record);
+        recorded_us_ = now_us;
+    }
+
+    if (batch.size() == batch_size_) {
+        sendBatch(shard, batch.data(), batch.size());
+        batch.clear();
+    }
+}
+
+void Client::flushBatches() {
+    for (size_t shard = 0; shard < batches_.size(); ++shard) {
+        sendBatch(shard, batches_[shard].data(), batches_[shard].size());
+        batches_[shard].clear();
+    }
+}
 
-        ClientMessage msg(client_id_, offset, op);
-        while (!buffer_.push(msg)) {
-            boost::this_thread::sleep_for(boost::chrono::nanoseconds(100));
+void Client::waitUntil(uint64_t due_ns) {
+    if (get_time_ns() >= due_ns) {
+        return;     // Behind schedule, send right away
+    }
+    // Do not hold earlier requests back in partial batches while waiting
+    flushBatches();
+    // Sleep most of the way, then yield past the timer slack; yielding
+    // rather than spinning keeps the managers running on a busy machine
+    uint64_t now = get_time_ns();
+    if (due_ns > now + 60000) {
+        boost::this_thread::sleep_for(boost::chrono::nanoseconds(due_ns - now - 50000));
+    }
+    while (get_time_ns() < due_ns) {
+        boost::this_thread::yield();
+    }
+}
+
+uint64_t Client::nextArrival() {
+    double interval_ns = 1e9 / load_.rate;
+    if (load_.poisson) {
+        interval_ns = std::exponential_distribution<double>(1.0 / interval_ns)(arrival_rng_);
+    }
+    // Keep the schedule independent of when the previous request actually went out
+    next_arrival_ns_ += static_cast<uint64_t>(interval_ns);
+    return next_arrival_ns_;
+}
+
+void Client::replayTrace() {
+    uint64_t start_ns = get_time_ns();
+    uint64_t trace_time_us = 0;
+    size_t replayed = 0;
+    TraceRecord record;
+    while (trace_->next(record)) {
+        // Timestamps advance on every record, including other clients' ones
+        trace_time_us += record.delta_us;
+        if (record.client_id != client_id_) {
+            continue;
         }
+        // Paced replay is open-loop with the recorded schedule
+        uint64_t intended_ns = 0;
+        if (trace_paced_) {
+            intended_ns = start_ns + trace_time_us * 1000;
+            waitUntil(intended_ns);
+        }
+        queueMessage(record.offset % memory_space_, record.op == 0 ? OperationType::READ : OperationType::WRITE, intended_ns);
+        replayed++;
+    }
+    LOG_DEBUG("Client " << client_id_ << " replayed " << replayed << " trace records");
+}
 
-        LOG_DEBUG("Client sent: " << msg.toString());
+void Client::run() {
+    start_ = boost::chrono::steady_clock::now();
+    if (trace_) {
+        replayTrace();
+    }
+    else {
+        size_t phase = 0;
+        next_arrival_ns_ = get_time_ns();
+        for (size_t i = 0; i < message_cnt_; ++i) {
+            uint64_t intended_ns = 0;
+            if (load_.rate > 0) {
+                intended_ns = nextArrival();
+                waitUntil(intended_ns);
+            }
+            size_t offset = generator_.generateOffset();
+            if (generator_.phase() != phase) {
+                phase = generator_.phase();
+                Metrics::getInstance().recordPhaseShift();
+                LOG_DEBUG("Client " << client_id_ << " shifted to phase " << phase);
+            }
+            queueMessage(offset, (i % 2 == 0) ? OperationType::READ : OperationType::WRITE, intended_ns);
+        }
     }
 
-    ClientMessage end_msg(client_id_, 0, OperationType::END); 
-    while (!buffer_.push(end_msg)) {
-        boost::this_thread::sleep_for(boost::chrono::nanoseconds(100));
+    // Flush partial batches, then tell every shard this client is done
+    flushBatches();
+    ClientMessage end_msg(client_id_, 0, OperationType::END);
+    for (size_t shard = 0; shard < batches_.size(); ++shard) {
+        sendBatch(shard, &end_msg, 1);
     }
     LOG_DEBUG("Client sent END message.");
+    if (recorder_) {
+        recorder_->close();
+    }
 }
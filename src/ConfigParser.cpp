@@ -6,16 +6,43 @@
  */
 ConfigParser::ConfigParser()
     : options_("MemoryTiering", "Concurrent Ring Buffer Demonstration"),
-    buffer_size_(10),
     message_count_(100),
     help_requested_(false) {
 
     options_.add_options()
         ("b,buffer-size", "Size of ring buffer",
             cxxopts::value<size_t>()->default_value("10"))
+        ("ring-buffer", "Ring buffer implementation (locked/lockfree)",
+            cxxopts::value<std::string>()->default_value("lockfree"))
+        ("batch-size", "Max messages pushed by a client or drained by the manager at once",
+            cxxopts::value<size_t>()->default_value("32"))
+        ("manager-threads", "Number of manager workers, each serving one shard of the pages",
+            cxxopts::value<size_t>()->default_value("1"))
+        ("migration-threads", "Number of background page migration workers",
+            cxxopts::value<size_t>()->default_value("1"))
+        ("migration-batch-size", "Max pages moved by one move_pages call",
+            cxxopts::value<size_t>()->default_value("64"))
+        ("migration-batch-timeout", "Max time in us a page waits for its migration batch to fill",
+            cxxopts::value<size_t>()->default_value("1000"))
+        ("scanner-threads", "Number of scanner threads, each sweeping one contiguous range of the pages",
+            cxxopts::value<size_t>()->default_value("1"))
+        ("rate", "Open-loop request rate per client in requests/sec, 0 for closed-loop",
+            cxxopts::value<double>()->default_value("0"))
+        ("arrivals", "Open-loop arrival process (poisson/constant)",
+            cxxopts::value<std::string>()->default_value("poisson"))
+        ("record-trace", "Record every client's accesses to <prefix>.<client>.trace",
+            cxxopts::value<std::string>()->default_value(""))
+        ("latency-cdf", "Write the full access, migration batch and request latency CDFs to this CSV file at the end of the run",
+            cxxopts::value<std::string>()->default_value(""))
+        ("metrics-output", "Write a time series of metric deltas to this file, JSON lines if it ends in .json/.jsonl, CSV otherwise",
+            cxxopts::value<std::string>()->default_value(""))
+        ("metrics-interval-ms", "Interval in milliseconds between two rows of --metrics-output",
+            cxxopts::value<size_t>()->default_value("1000"))
+        ("recovery-window-ms", "Hit ratio window in milliseconds for measuring recovery from phase shifts",
+            cxxopts::value<size_t>()->default_value("10"))
         ("m,messages", "Number of messages per client",
             cxxopts::value<size_t>()->default_value("100"))
-        ("p,patterns", "Memory access patterns for each client (uniform/skewed)",
+        ("p,patterns", "Memory access patterns for each client (uniform/skewed/zipf[:theta]/scrambled-zipf[:theta]/hotspot[:set:ops]/latest[:theta]/gaussian[:stddev], phase shifts with @shift=N or @shift=Nms and @jump or @rotate=F, or trace:FILE[@paced] to replay a trace)",
             cxxopts::value<std::vector<std::string>>())
         ("c,client-addr-space-sizes", "Address space size for each client",
             cxxopts::value<std::vector<size_t>>())
@@ -23,10 +50,20 @@ ConfigParser::ConfigParser()
             cxxopts::value<size_t>()->default_value("3"))
         ("s,mem-sizes", "Memory size for each tiering",
             cxxopts::value<std::vector<size_t>>())
+        ("policy", "Tiering policy (threshold/clock/lru-k/lfu/arc)",
+            cxxopts::value<std::string>()->default_value("threshold"))
         ("hot-access-cnt", "Access count for determine a hot page",
             cxxopts::value<size_t>()->default_value("10"))
-        ("cold-access-interval", "Access interval for determine a cold page",
+        ("cold-access-interval", "Access interval in epochs for determine a cold page",
             cxxopts::value<size_t>()->default_value("1000"))
+        ("epoch-ms", "Length of one page table epoch in milliseconds",
+            cxxopts::value<size_t>()->default_value("1"))
+        ("access-decay-shift", "Right shift applied to access counters on every scanner pass (0 disables decay)",
+            cxxopts::value<size_t>()->default_value("1"))
+        ("high-watermark", "Fast tier occupancy fraction that starts background demotion",
+            cxxopts::value<double>()->default_value("0.95"))
+        ("low-watermark", "Fast tier occupancy fraction at which background demotion stops",
+            cxxopts::value<double>()->default_value("0.9"))
         ("h,help", "Print usage information");
 }
 
@@ -47,10 +84,120 @@ bool ConfigParser::parse(int argc, char* argv[]) {
     }
 
     // Parse basic parameters
-    buffer_size_ = result["buffer-size"].as<size_t>();
+    server_runtime_config_.buffer_size = result["buffer-size"].as<size_t>();
     message_count_ = result["messages"].as<size_t>();
+
+    server_runtime_config_.batch_size = result["batch-size"].as<size_t>();
+    if (server_runtime_config_.batch_size == 0) {
+        LOG_ERROR("Error: Batch size must be at least 1");
+        return false;
+    }
+    server_runtime_config_.manager_threads = result["manager-threads"].as<size_t>();
+    if (server_runtime_config_.manager_threads == 0) {
+        LOG_ERROR("Error: Number of manager threads must be at least 1");
+        return false;
+    }
+    server_runtime_config_.migration_threads = result["migration-threads"].as<size_t>();
+    if (server_runtime_config_.migration_threads == 0) {
+        LOG_ERROR("Error: Number of migration threads must be at least 1");
+        return false;
+    }
+    server_runtime_config_.migration_batch_size = result["migration-batch-size"].as<size_t>();
+    if (server_runtime_config_.migration_batch_size == 0) {
+        LOG_ERROR("Error: Migration batch size must be at least 1");
+        return false;
+    }
+    server_runtime_config_.migration_batch_timeout_us = result["migration-batch-timeout"].as<size_t>();
+    load_config_.rate = result["rate"].as<double>();
+    if (load_config_.rate < 0) {
+        LOG_ERROR("Error: Request rate must not be negative");
+        return false;
+    }
+    std::string arrivals = result["arrivals"].as<std::string>();
+    if (arrivals != "poisson" && arrivals != "constant") {
+        LOG_ERROR("Invalid arrival process: " << arrivals);
+        return false;
+    }
+    load_config_.poisson = arrivals == "poisson";
+    record_trace_prefix_ = result["record-trace"].as<std::string>();
+    server_runtime_config_.latency_cdf_path = result["latency-cdf"].as<std::string>();
+    server_runtime_config_.metrics_output_path = result["metrics-output"].as<std::string>();
+    server_runtime_config_.metrics_interval_ms = result["metrics-interval-ms"].as<size_t>();
+    if (server_runtime_config_.metrics_interval_ms == 0) {
+        LOG_ERROR("Error: Metrics interval must be at least 1 ms");
+        return false;
+    }
+    server_runtime_config_.recovery_window_ms = result["recovery-window-ms"].as<size_t>();
+    if (server_runtime_config_.recovery_window_ms == 0) {
+        LOG_ERROR("Error: Recovery window must be at least 1 ms");
+        return false;
+    }
+    server_runtime_config_.scanner_threads = result["scanner-threads"].as<size_t>();
+    if (server_runtime_config_.scanner_threads == 0) {
+        LOG_ERROR("Error: Number of scanner threads must be at least 1");
+        return false;
+    }
+
+    // Parse ring buffer implementation
+    auto ring_buffer = result["ring-buffer"].as<std::string>();
+    if (ring_buffer == "locked") {
+        server_runtime_config_.ring_buffer_type = RingBufferType::LOCKED;
+    }
+    else if (ring_buffer == "lockfree") {
+        server_runtime_config_.ring_buffer_type = RingBufferType::LOCK_FREE;
+    }
+    else {
+        LOG_ERROR("Invalid ring buffer type: " << ring_buffer);
+        return false;
+    }
+
+    // Parse tiering policy
+    auto policy = result["policy"].as<std::string>();
+    policy_name_ = policy;
+    if (policy == "threshold") {
+        policy_config_.policy_type = TieringPolicyType::THRESHOLD;
+    }
+    else if (policy == "clock") {
+        policy_config_.policy_type = TieringPolicyType::CLOCK;
+    }
+    else if (policy == "lru-k") {
+        policy_config_.policy_type = TieringPolicyType::LRU_K;
+    }
+    else if (policy == "lfu") {
+        policy_config_.policy_type = TieringPolicyType::LFU;
+    }
+    else if (policy == "arc") {
+        policy_config_.policy_type = TieringPolicyType::ARC;
+    }
+    else {
+        LOG_ERROR("Invalid tiering policy: " << policy);
+        return false;
+    }
+
     policy_config_.hot_access_cnt = result["hot-access-cnt"].as<size_t>();
     policy_config_.cold_access_interval = result["cold-access-interval"].as<size_t>();
+    // Access counts and epochs are 32-bit in the page table
+    if (policy_config_.hot_access_cnt > UINT32_MAX || policy_config_.cold_access_interval > UINT32_MAX) {
+        LOG_ERROR("Error: Hot access count and cold access interval must be at most " << UINT32_MAX);
+        return false;
+    }
+    policy_config_.epoch_ms = result["epoch-ms"].as<size_t>();
+    if (policy_config_.epoch_ms == 0) {
+        LOG_ERROR("Error: Epoch length must be at least 1 ms");
+        return false;
+    }
+    policy_config_.access_decay_shift = result["access-decay-shift"].as<size_t>();
+    if (policy_config_.access_decay_shift > 31) {
+        LOG_ERROR("Error: Access decay shift must be at most 31");
+        return false;
+    }
+    policy_config_.high_watermark = result["high-watermark"].as<double>();
+    policy_config_.low_watermark = result["low-watermark"].as<double>();
+    if (policy_config_.low_watermark < 0.0 || policy_config_.low_watermark > policy_config_.high_watermark
+        || policy_config_.high_watermark > 1.0) {
+        LOG_ERROR("Error: Watermarks must satisfy 0 <= low <= high <= 1");
+        return false;
+    }
 
     // Parse client configurations
     auto patterns = result["patterns"].as<std::vector<std::string>>();
@@ -69,13 +216,7 @@ bool ConfigParser::parse(int argc, char* argv[]) {
         config.addr_space_size = client_addr_space_sizes[i];
 
         // Parse access pattern type
-        if (patterns[i] == "uniform") {
-            config.pattern = AccessPattern::UNIFORM;
-        }
-        else if (patterns[i] == "skewed") {
-            config.pattern = AccessPattern::SKEWED_70_20_10;
-        }
-        else {
+        if (!parsePattern(patterns[i], config.pattern)) {
             LOG_ERROR("Invalid pattern type: " << patterns[i]);
             return false;
         }
@@ -117,13 +258,39 @@ void ConfigParser::printConfig() const {
     LOG_INFO("========== Configuration Parameters ==========");
 
     // Basic parameters
-    LOG_INFO("Buffer Size: " << buffer_size_);
+    LOG_INFO("Buffer Size: " << server_runtime_config_.buffer_size);
+    LOG_INFO("Ring Buffer: " << (server_runtime_config_.ring_buffer_type == RingBufferType::LOCKED ? "Locked" : "Lock-free"));
     LOG_INFO("Message Count: " << message_count_);
+    LOG_INFO("Batch Size: " << server_runtime_config_.batch_size);
+    LOG_INFO("Manager Threads: " << server_runtime_config_.manager_threads);
+    LOG_INFO("Migration Threads: " << server_runtime_config_.migration_threads);
+    LOG_INFO("Scanner Threads: " << server_runtime_config_.scanner_threads);
+    LOG_INFO("Migration Batch: " << server_runtime_config_.migration_batch_size << " pages / "
+        << server_runtime_config_.migration_batch_timeout_us << " us");
+    LOG_INFO("Recovery Window: " << server_runtime_config_.recovery_window_ms << " ms");
+    if (load_config_.rate > 0) {
+        LOG_INFO("Open-Loop Rate: " << load_config_.rate << " requests/sec per client, "
+            << (load_config_.poisson ? "poisson" : "constant") << " arrivals");
+    }
+    if (!record_trace_prefix_.empty()) {
+        LOG_INFO("Recording Traces: " << record_trace_prefix_ << ".<client>.trace");
+    }
+    if (!server_runtime_config_.latency_cdf_path.empty()) {
+        LOG_INFO("Latency CDF: " << server_runtime_config_.latency_cdf_path);
+    }
+    if (!server_runtime_config_.metrics_output_path.empty()) {
+        LOG_INFO("Metrics Time Series: " << server_runtime_config_.metrics_output_path << " every "
+            << server_runtime_config_.metrics_interval_ms << " ms");
+    }
 
     // Policy configuration
     LOG_INFO("Hot Page Policy:");
+    LOG_INFO("  - Policy: " << policy_name_);
     LOG_INFO("  - Hot Access Count: " << policy_config_.hot_access_cnt);
-    LOG_INFO("  - Cold Access Interval: " << policy_config_.cold_access_interval << " ms");
+    LOG_INFO("  - Cold Access Interval: " << policy_config_.cold_access_interval << " epochs of "
+        << policy_config_.epoch_ms << " ms");
+    LOG_INFO("  - Access Decay Shift: " << policy_config_.access_decay_shift);
+    LOG_INFO("  - Watermarks: high " << policy_config_.high_watermark << ", low " << policy_config_.low_watermark);
 
     // Number of tiers
     LOG_INFO("Number of Tiers: " << server_memory_config_.num_tiers);
@@ -144,10 +311,192 @@ void ConfigParser::printConfig() const {
     LOG_INFO("Client Configurations:");
     for (size_t i = 0; i < client_configs_.size(); i++) {
         LOG_INFO("  Client " << i + 1 << ":");
-        LOG_INFO("    - Pattern: " <<
-            (client_configs_[i].pattern == AccessPattern::UNIFORM ? "Uniform" : "Skewed"));
+        LOG_INFO("    - Pattern: " << patternName(client_configs_[i].pattern));
         LOG_INFO("    - Address Space Size: " << client_configs_[i].addr_space_size << " pages");
     }
 
     LOG_INFO("==========================================");
-}
\ No newline at end of file
+}
+
+bool ConfigParser::parsePattern(const std::string& spec, AccessPatternConfig& pattern) {
+    // trace:PATH[@paced], the path may contain ':' and '@'; the client reports a trace it cannot open
+    if (spec.compare(0, 6, "trace:") == 0) {
+        pattern = AccessPatternConfig();
+        pattern.type = AccessPattern::TRACE;
+        pattern.trace_path = spec.substr(6);
+        size_t at = pattern.trace_path.rfind('@');
+        if (at != std::string::npos && pattern.trace_path.compare(at + 1, std::string::npos, "paced") == 0) {
+            pattern.trace_path.erase(at);
+            pattern.trace_paced = true;
+        }
+        return !pattern.trace_path.empty();
+    }
+
+    // Split the phase shift options off at '@', then name and parameters at ':'
+    std::vector<std::string> options;
+    std::stringstream option_ss(spec);
+    std::string option;
+    while (std::getline(option_ss, option, '@')) {
+        options.push_back(option);
+    }
+    if (options.empty()) {
+        return false;
+    }
+
+    std::vector<std::string> fields;
+    std::stringstream ss(options[0]);
+    std::string field;
+    while (std::getline(ss, field, ':')) {
+        fields.push_back(field);
+    }
+    if (fields.empty()) {
+        return false;
+    }
+    std::vector<double> params;
+    for (size_t i = 1; i < fields.size(); i++) {
+        try {
+            size_t parsed = 0;
+            params.push_back(std::stod(fields[i], &parsed));
+            if (parsed != fields[i].size()) {
+                return false;
+            }
+        }
+        catch (const std::exception&) {
+            return false;
+        }
+    }
+
+    pattern = AccessPatternConfig();
+    const std::string& name = fields[0];
+    size_t max_params = 0;
+    if (name == "uniform") {
+        pattern.type = AccessPattern::UNIFORM;
+    }
+    else if (name == "skewed") {
+        pattern.type = AccessPattern::SKEWED_70_20_10;
+    }
+    else if (name == "zipf" || name == "scrambled-zipf" || name == "latest") {
+        pattern.type = (name == "zipf") ? AccessPattern::ZIPFIAN
+            : (name == "latest") ? AccessPattern::LATEST : AccessPattern::SCRAMBLED_ZIPFIAN;
+        max_params = 1;
+        if (!params.empty()) {
+            pattern.zipf_theta = params[0];
+        }
+        if (pattern.zipf_theta <= 0.0 || pattern.zipf_theta >= 1.0) {
+            return false;
+        }
+    }
+    else if (name == "hotspot") {
+        pattern.type = AccessPattern::HOTSPOT;
+        max_params = 2;
+        if (params.size() > 0) {
+            pattern.hot_set_fraction = params[0];
+        }
+        if (params.size() > 1) {
+            pattern.hot_op_fraction = params[1];
+        }
+        if (pattern.hot_set_fraction <= 0.0 || pattern.hot_set_fraction > 1.0
+            || pattern.hot_op_fraction < 0.0 || pattern.hot_op_fraction > 1.0) {
+            return false;
+        }
+    }
+    else if (name == "gaussian") {
+        pattern.type = AccessPattern::GAUSSIAN;
+        max_params = 1;
+        if (!params.empty()) {
+            pattern.stddev_fraction = params[0];
+        }
+        if (pattern.stddev_fraction <= 0.0) {
+            return false;
+        }
+    }
+    else {
+        return false;
+    }
+    if (params.size() > max_params) {
+        return false;
+    }
+
+    // Phase shifts: shift=N (accesses), shift=Nms, jump, rotate=F
+    for (size_t i = 1; i < options.size(); i++) {
+        const std::string& opt = options[i];
+        try {
+            size_t parsed = 0;
+            if (opt == "jump") {
+                pattern.shift_jump = true;
+            }
+            else if (opt.compare(0, 7, "rotate=") == 0) {
+                pattern.shift_jump = false;
+                pattern.shift_stride = std::stod(opt.substr(7), &parsed);
+                if (parsed != opt.size() - 7 || pattern.shift_stride <= 0.0 || pattern.shift_stride >= 1.0) {
+                    return false;
+                }
+            }
+            else if (opt.compare(0, 6, "shift=") == 0) {
+                std::string value = opt.substr(6);
+                bool in_ms = value.size() > 2 && value.compare(value.size() - 2, 2, "ms") == 0;
+                if (in_ms) {
+                    value.resize(value.size() - 2);
+                }
+                size_t period = std::stoull(value, &parsed);
+                if (parsed != value.size() || period == 0) {
+                    return false;
+                }
+                (in_ms ? pattern.shift_ms : pattern.shift_ops) = period;
+            }
+            else {
+                return false;
+            }
+        }
+        catch (const std::exception&) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string ConfigParser::patternName(const AccessPatternConfig& pattern) {
+    std::stringstream ss;
+    switch (pattern.type) {
+    case AccessPattern::UNIFORM:
+        ss << "uniform";
+        break;
+    case AccessPattern::SKEWED_70_20_10:
+        ss << "skewed";
+        break;
+    case AccessPattern::ZIPFIAN:
+        ss << "zipf:" << pattern.zipf_theta;
+        break;
+    case AccessPattern::SCRAMBLED_ZIPFIAN:
+        ss << "scrambled-zipf:" << pattern.zipf_theta;
+        break;
+    case AccessPattern::HOTSPOT:
+        ss << "hotspot:" << pattern.hot_set_fraction << ":" << pattern.hot_op_fraction;
+        break;
+    case AccessPattern::LATEST:
+        ss << "latest:" << pattern.zipf_theta;
+        break;
+    case AccessPattern::GAUSSIAN:
+        ss << "gaussian:" << pattern.stddev_fraction;
+        break;
+    case AccessPattern::TRACE:
+        ss << "trace:" << pattern.trace_path << (pattern.trace_paced ? "@paced" : "");
+        break;
+    }
+    if (pattern.shift_ops > 0 || pattern.shift_ms > 0) {
+        ss << "@shift=";
+        if (pattern.shift_ops > 0) {
+            ss << pattern.shift_ops;
+        }
+        else {
+            ss << pattern.shift_ms << "ms";
+        }
+        if (pattern.shift_jump) {
+            ss << "@jump";
+        }
+        else {
+            ss << "@rotate=" << pattern.shift_stride;
+        }
+    }
+    return ss.str();
+}
@@ -1,88 +1,433 @@
 #include "Metrics.hpp"
 #include "Logger.hpp"
 
+#include <fstream>
+
+Metrics::~Metrics() {
+    CounterShard* shard = counter_shards_.load();
+    while (shard != nullptr) {
+        CounterShard* next = shard->next;
+        delete shard;
+        shard = next;
+    }
+}
+
+Metrics::CounterShard* Metrics::addCounterShard() {
+    CounterShard* shard = new CounterShard();
+    shard->next = counter_shards_.load();
+    while (!counter_shards_.compare_exchange_weak(shard->next, shard)) {
+    }
+    return shard;
+}
+
+uint64_t Metrics::counter(Counter counter) const {
+    uint64_t total = 0;
+    for (CounterShard* shard = counter_shards_.load(); shard != nullptr; shard = shard->next) {
+        total += shard->values[counter].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+Metrics::CounterSnapshot Metrics::counters() const {
+    CounterSnapshot totals{};
+    for (CounterShard* shard = counter_shards_.load(); shard != nullptr; shard = shard->next) {
+        for (size_t i = 0; i < NUM_COUNTERS; ++i) {
+            totals[i] += shard->values[i].load(std::memory_order_relaxed);
+        }
+    }
+    return totals;
+}
+
+void Metrics::startTimer() {
+    start_time_ns_ = get_time_ns();
+}
+
+void Metrics::printMigrationBatches(const CounterSnapshot& counters) const {
+    uint64_t batches = counters[MIGRATION_BATCHES];
+    LOG_INFO("Migration Batches:");
+    LOG_INFO("  Batches: " << batches);
+    if (batches > 0) {
+        LOG_INFO("  Pages/Batch: " << static_cast<double>(counters[MIGRATION_BATCH_PAGES]) / batches);
+        LOG_INFO("  Avg Batch Latency (ns): " << static_cast<double>(counters[MIGRATION_BATCH_LATENCY]) / batches);
+    }
+    LOG_INFO("  Failed Pages: " << counters[MIGRATION_FAILURES]);
+    LOG_INFO("  Cancelled Requests: " << counters[CANCELLED_MOVES]);
+    LOG_INFO("  Refused (Tier Full): " << counters[REFUSED_MOVES]);
+    LOG_INFO("  Reclaim Demotions: " << counters[RECLAIM_DEMOTIONS]);
+}
+
+void Metrics::sampleHitRatioWindow(uint64_t now_ns) {
+    boost::lock_guard<boost::mutex> lock(recovery_mutex_);
+    RecoveryTracker& r = recovery_;
+    uint64_t local = counter(LOCAL_ACCESS);
+    uint64_t total = local + counter(REMOTE_ACCESS) + counter(PMEM_ACCESS);
+    uint64_t window_local = local - r.window_local;
+    uint64_t window_total = total - r.window_total;
+    r.window_local = local;
+    r.window_total = total;
+
+    uint64_t shift_ns = pending_shift_ns_.exchange(0);
+    if (shift_ns != 0) {
+        if (r.recovering) {
+            // The tier never settled between the two shifts: time the
+            // recovery from the latest one, towards the same steady state
+            r.restarted++;
+            r.shift_ns = shift_ns;
+        }
+        else if (r.steady_windows == 0) {
+            r.untracked++;  // Nothing to recover to yet
+        }
+        else {
+            size_t samples = std::min(r.steady_windows, STEADY_WINDOWS);
+            double steady_sum = 0;
+            for (size_t i = 0; i < samples; ++i) {
+                steady_sum += r.steady[i];
+            }
+            r.recovering = true;
+            r.started++;
+            r.shift_ns = shift_ns;
+            r.target = (steady_sum / samples) * (1.0 - RECOVERY_TOLERANCE);
+        }
+    }
+    if (window_total == 0) {
+        return;
+    }
+    // Cold start: the fast tier is still filling up
+    if (r.warmup_windows < WARMUP_WINDOWS) {
+        r.warmup_windows++;
+        return;
+    }
+
+    double hit_ratio = static_cast<double>(window_local) / window_total;
+    if (r.recovering) {
+        if (hit_ratio < r.target || shift_ns != 0) {
+            return;
+        }
+        // The window that ends a recovery is not a steady sample
+        uint64_t recovery_ns = now_ns - r.shift_ns;
+        r.recovering = false;
+        r.recoveries++;
+        r.recovery_total_ns += recovery_ns;
+        r.recovery_max_ns = std::max(r.recovery_max_ns, recovery_ns);
+        return;
+    }
+    r.steady[r.steady_windows % STEADY_WINDOWS] = hit_ratio;
+    r.steady_windows++;
+}
+
+void Metrics::printPhaseRecovery() const {
+    uint64_t shifts = counter(PHASE_SHIFTS);
+    if (shifts == 0) {
+        return;
+    }
+    boost::lock_guard<boost::mutex> lock(recovery_mutex_);
+    LOG_INFO("Phase Shifts:");
+    LOG_INFO("  Shifts: " << shifts);
+    LOG_INFO("  Recoveries Started: " << recovery_.started);
+    LOG_INFO("  Restarted By Another Shift: " << recovery_.restarted);
+    LOG_INFO("  Untracked (No Steady State Yet): " << recovery_.untracked);
+    LOG_INFO("  Recovered: " << recovery_.recoveries << (recovery_.recovering ? " (still recovering)" : ""));
+    if (recovery_.recoveries > 0) {
+        LOG_INFO("  Avg Time To Recover (ms): " << static_cast<double>(recovery_.recovery_total_ns) / recovery_.recoveries / 1e6);
+        LOG_INFO("  Worst Time To Recover (ms): " << static_cast<double>(recovery_.recovery_max_ns) / 1e6);
+    }
+}
+
+std::atomic<size_t> LatencyHistogram::next_id_{ 0 };
+
+LatencyHistogram::LatencyHistogram() : id_(next_id_.fetch_add(1)) {
+}
+
+LatencyHistogram::~LatencyHistogram() {
+    Shard* shard = shards_.load();
+    while (shard != nullptr) {
+        Shard* next = shard->next;
+        delete shard;
+        shard = next;
+    }
+}
+
+void LatencyHistogram::Shard::clear() {
+    for (auto& bucket : counts) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+    min.store(UINT64_MAX, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+}
+
+LatencyHistogram::Shard& LatencyHistogram::addShard(std::vector<Shard*>& thread_shards) {
+    Shard* shard = new Shard();
+    shard->next = shards_.load();
+    while (!shards_.compare_exchange_weak(shard->next, shard)) {
+    }
+    if (thread_shards.size() <= id_) {
+        thread_shards.resize(id_ + 1, nullptr);
+    }
+    thread_shards[id_] = shard;
+    return *shard;
+}
+
+uint64_t LatencyHistogram::count() const {
+    uint64_t total = 0;
+    for (Shard* shard = shards_.load(); shard != nullptr; shard = shard->next) {
+        total += shard->count.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const {
+    Snapshot merged;
+    uint64_t min = UINT64_MAX;
+    for (Shard* shard = shards_.load(); shard != nullptr; shard = shard->next) {
+        for (size_t bucket = 0; bucket < NUM_BUCKETS; ++bucket) {
+            merged.counts[bucket] += shard->counts[bucket].load(std::memory_order_relaxed);
+        }
+        merged.sum += shard->sum.load(std::memory_order_relaxed);
+        min = std::min(min, shard->min.load(std::memory_order_relaxed));
+        merged.max = std::max(merged.max, shard->max.load(std::memory_order_relaxed));
+    }
+    // Count the buckets rather than the shard counters so percentiles always add up
+    for (uint64_t count : merged.counts) {
+        merged.count += count;
+    }
+    merged.min = merged.count > 0 ? min : 0;
+    return merged;
+}
+
+double LatencyHistogram::Snapshot::percentile(double percentile) const {
+    if (count == 0) {
+        return 0.0;
+    }
+    // Rank of the percentile among the recorded values, 1-based
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percentile / 100.0 * count)));
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < NUM_BUCKETS; ++bucket) {
+        seen += counts[bucket];
+        if (seen >= rank) {
+            double value = static_cast<double>(bucketLow(bucket)) + static_cast<double>(bucketWidth(bucket) - 1) / 2;
+            return std::min(std::max(value, static_cast<double>(min)), static_cast<double>(max));
+        }
+    }
+    return static_cast<double>(max);
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::Snapshot::since(const Snapshot& earlier) const {
+    if (earlier.count > count) {
+        return *this;   // Reset in between
+    }
+    Snapshot delta;
+    size_t first = NUM_BUCKETS;
+    size_t last = 0;
+    for (size_t bucket = 0; bucket < NUM_BUCKETS; ++bucket) {
+        delta.counts[bucket] = counts[bucket] - earlier.counts[bucket];
+        if (delta.counts[bucket] > 0) {
+            first = std::min(first, bucket);
+            last = bucket;
+        }
+    }
+    delta.count = count - earlier.count;
+    delta.sum = sum - earlier.sum;
+    if (delta.count > 0) {
+        delta.min = std::max(bucketLow(first), min);
+        delta.max = std::min(bucketLow(last) + bucketWidth(last) - 1, max);
+    }
+    return delta;
+}
+
+void LatencyHistogram::writeCdf(std::ostream& out, const std::string& name) const {
+    Snapshot merged = snapshot();
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < NUM_BUCKETS && seen < merged.count; ++bucket) {
+        if (merged.counts[bucket] == 0) {
+            continue;
+        }
+        seen += merged.counts[bucket];
+        out << name << ',' << std::min(bucketLow(bucket) + bucketWidth(bucket) - 1, merged.max) << ',' << seen << ','
+            << static_cast<double>(seen) / merged.count << '\n';
+    }
+}
+
+void LatencyHistogram::reset() {
+    for (Shard* shard = shards_.load(); shard != nullptr; shard = shard->next) {
+        shard->clear();
+    }
+}
+
+void Metrics::setNumClients(size_t num_clients) {
+    client_breakdown_.reset(new LatencyBreakdown[num_clients]);
+    num_clients_ = num_clients;
+}
+
+void Metrics::printLatencyBreakdown(const char* const tier_names[], size_t num_tiers) const {
+    auto summary = [](const LatencyHistogram& latency) {
+        LatencyHistogram::Snapshot merged = latency.snapshot();
+        std::stringstream ss;
+        ss << "p50 " << merged.percentile(50) << " p99 " << merged.percentile(99)
+            << " p99.9 " << merged.percentile(99.9);
+        return ss.str();
+    };
+    auto print = [&summary](const std::string& name, const LatencyBreakdown& breakdown) {
+        if (breakdown.end_to_end.count() == 0) {
+            return;
+        }
+        LOG_INFO("  " << name << ": queue " << summary(breakdown.queue_wait)
+            << " | service " << summary(breakdown.service)
+            << " | end-to-end " << summary(breakdown.end_to_end));
+    };
+
+    LOG_INFO("Latency Breakdown (ns):");
+    // Two tiers keep their pages in the local and PMEM layers
+    const PageLayer layers[] = { PageLayer::NUMA_LOCAL, PageLayer::NUMA_REMOTE, PageLayer::PMEM };
+    for (size_t i = 0; i < num_tiers; ++i) {
+        PageLayer layer = (num_tiers == 2 && i == 1) ? PageLayer::PMEM : layers[i];
+        print(std::string(tier_names[i]) + " tier", tier_breakdown_[static_cast<size_t>(layer)]);
+    }
+    for (size_t client = 0; client < num_clients_; ++client) {
+        print("Client " + std::to_string(client), client_breakdown_[client]);
+    }
+}
+
+void Metrics::printRequestLatency() const {
+    // One line per distribution: the Min:/P50:/... lines belong to access and migration batch latency
+    LatencyHistogram::Snapshot requests = request_latency_.snapshot();
+    if (requests.count == 0) {
+        return;
+    }
+    LOG_INFO("Open-Loop Requests: " << requests.count);
+    LOG_INFO("  Request Latency (ns): mean " << requests.mean()
+        << " p50 " << requests.percentile(50)
+        << " p99 " << requests.percentile(99)
+        << " p99.9 " << requests.percentile(99.9)
+        << " max " << requests.max);
+}
+
+void Metrics::printLatency(const char* title, const LatencyHistogram& latency) const {
+    LatencyHistogram::Snapshot merged = latency.snapshot();
+    LOG_INFO(title);
+    LOG_INFO("  Min:  " << merged.min);
+    LOG_INFO("  P50:  " << merged.percentile(50));
+    LOG_INFO("  P99:  " << merged.percentile(99));
+    LOG_INFO("  Max:  " << merged.max);
+    LOG_INFO("  Mean: " << merged.mean());
+    LOG_INFO("  P99.9:  " << merged.percentile(99.9));
+    LOG_INFO("  P99.99: " << merged.percentile(99.99));
+}
+
+bool Metrics::writeLatencyCdf(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out) {
+        LOG_ERROR("Cannot write latency CDF to " << path);
+        return false;
+    }
+    out << "distribution,value_ns,count,fraction\n";
+    access_latency_.writeCdf(out, "access");
+    migration_batch_latency_.writeCdf(out, "migration_batch");
+    request_latency_.writeCdf(out, "request");
+    LOG_INFO("Latency CDF written to " << path);
+    return static_cast<bool>(out);
+}
+
+double Metrics::localHitRatio(const CounterSnapshot& counters) {
+    uint64_t local = counters[LOCAL_ACCESS];
+    uint64_t total = local + counters[REMOTE_ACCESS] + counters[PMEM_ACCESS];
+    return total > 0 ? static_cast<double>(local) / total : 0.0;
+}
+
+double Metrics::wallClockRate(uint64_t total_access) const {
+    uint64_t elapsed = get_time_ns() - start_time_ns_.load();
+    return elapsed > 0 ? static_cast<double>(total_access) * 1e9 / static_cast<double>(elapsed) : 0.0;
+}
+
 void Metrics::printMetricsThreeTiers() const {
+    CounterSnapshot counters = this->counters();
     LOG_INFO("======== Memory Access Metrics ========");
     LOG_INFO("Access Counts:");
-    LOG_INFO("  NUMA Local:  " << local_access_count_.load());
-    LOG_INFO("  NUMA Remote: " << remote_access_count_.load());
-    LOG_INFO("  PMEM:        " << pmem_access_count_.load());
+    LOG_INFO("  NUMA Local:  " << counters[LOCAL_ACCESS]);
+    LOG_INFO("  NUMA Remote: " << counters[REMOTE_ACCESS]);
+    LOG_INFO("  PMEM:        " << counters[PMEM_ACCESS]);
+    LOG_INFO("  During Migration: " << counters[MIGRATING_ACCESS]);
+    LOG_INFO("  Local Hit Ratio: " << localHitRatio(counters));
 
-    LOG_INFO("Access Latency (ns):");
-    LOG_INFO("  Min:  " << acc::min(access_latency_));
-    LOG_INFO("  P50:  " << acc::extended_p_square(access_latency_)[1]);  // 50th percentile
-    LOG_INFO("  P99:  " << acc::extended_p_square(access_latency_)[2]);  // 99th percentile
-    LOG_INFO("  Max:  " << acc::max(access_latency_));
-    LOG_INFO("  Mean: " << acc::mean(access_latency_));
+    printLatency("Access Latency (ns):", access_latency_);
 
     LOG_INFO("Migration Counts:");
-    LOG_INFO("  Local -> Remote: " << local_to_remote_count_.load());
-    LOG_INFO("  Remote -> Local: " << remote_to_local_count_.load());
-    LOG_INFO("  PMEM -> Remote: " << pmem_to_remote_count_.load());
-    LOG_INFO("  Remote -> PMEM: " << remote_to_pmem_count_.load());
-    LOG_INFO("  Local -> PMEM: " << local_to_pmem_count_.load());
-    LOG_INFO("  PMEM -> Local: " << pmem_to_local_count_.load());
-
-    LOG_INFO("Migration Latency (ns):");
-    LOG_INFO("  Min:  " << acc::min(migration_latency_));  // Fixed: was using access_latency_
-    LOG_INFO("  P50:  " << acc::extended_p_square(migration_latency_)[1]);  // Fixed: was using access_latency_
-    LOG_INFO("  P99:  " << acc::extended_p_square(migration_latency_)[2]);  // Fixed: was using access_latency_
-    LOG_INFO("  Max:  " << acc::max(migration_latency_));
-    LOG_INFO("  Mean: " << acc::mean(migration_latency_));
-
-    if (total_latency_.load() > 0) {
+    LOG_INFO("  Local -> Remote: " << counters[LOCAL_TO_REMOTE]);
+    LOG_INFO("  Remote -> Local: " << counters[REMOTE_TO_LOCAL]);
+    LOG_INFO("  PMEM -> Remote: " << counters[PMEM_TO_REMOTE]);
+    LOG_INFO("  Remote -> PMEM: " << counters[REMOTE_TO_PMEM]);
+    LOG_INFO("  Local -> PMEM: " << counters[LOCAL_TO_PMEM]);
+    LOG_INFO("  PMEM -> Local: " << counters[PMEM_TO_LOCAL]);
+
+    printLatency("Migration Batch Latency (ns):", migration_batch_latency_);
+    printMigrationBatches(counters);
+    printPhaseRecovery();
+    printRequestLatency();
+    static const char* const tier_names[] = { "Local", "Remote", "PMEM" };
+    printLatencyBreakdown(tier_names, 3);
+
+    if (counters[TOTAL_LATENCY] > 0) {
         LOG_INFO("Throughput:");
-        uint64_t total_access = local_access_count_.load() + remote_access_count_.load() + pmem_access_count_.load();
-        double throughput = static_cast<double>(total_access) * 1e9 / static_cast<double>(total_latency_.load());
+        uint64_t total_access = counters[LOCAL_ACCESS] + counters[REMOTE_ACCESS] + counters[PMEM_ACCESS];
+        double throughput = static_cast<double>(total_access) * 1e9 / static_cast<double>(counters[TOTAL_LATENCY]);
         LOG_INFO("  Throughput: " << throughput << " ops/sec");
+        LOG_INFO("  Wall-clock: " << wallClockRate(total_access) << " ops/sec");
     }
     LOG_INFO("===================================");
 }
 
 void Metrics::printMetricsTwoTiers() const {
+    CounterSnapshot counters = this->counters();
     LOG_INFO("======== Memory Access Metrics (Two Tiers) ========");
     LOG_INFO("Access Counts:");
-    LOG_INFO("  DRAM: " << local_access_count_.load());
-    LOG_INFO("  PMEM: " << pmem_access_count_.load());
+    LOG_INFO("  DRAM: " << counters[LOCAL_ACCESS]);
+    LOG_INFO("  PMEM: " << counters[PMEM_ACCESS]);
+    LOG_INFO("  During Migration: " << counters[MIGRATING_ACCESS]);
+    LOG_INFO("  DRAM Hit Ratio: " << localHitRatio(counters));
 
-    LOG_INFO("Access Latency (ns):");
-    LOG_INFO("  Min:  " << acc::min(access_latency_));
-    LOG_INFO("  P50:  " << acc::extended_p_square(access_latency_)[1]);
-    LOG_INFO("  P99:  " << acc::extended_p_square(access_latency_)[2]);
-    LOG_INFO("  Max:  " << acc::max(access_latency_));
-    LOG_INFO("  Mean: " << acc::mean(access_latency_));
+    printLatency("Access Latency (ns):", access_latency_);
 
     LOG_INFO("Migration Counts:");
-    LOG_INFO("  DRAM -> PMEM: " << local_to_pmem_count_.load());
-    LOG_INFO("  PMEM -> DRAM: " << pmem_to_local_count_.load());
+    LOG_INFO("  DRAM -> PMEM: " << counters[LOCAL_TO_PMEM]);
+    LOG_INFO("  PMEM -> DRAM: " << counters[PMEM_TO_LOCAL]);
 
-    LOG_INFO("Migration Latency (ns):");
-    LOG_INFO("  Min:  " << acc::min(migration_latency_));
-    LOG_INFO("  P50:  " << acc::extended_p_square(migration_latency_)[1]);
-    LOG_INFO("  P99:  " << acc::extended_p_square(migration_latency_)[2]);
-    LOG_INFO("  Max:  " << acc::max(migration_latency_));
-    LOG_INFO("  Mean: " << acc::mean(migration_latency_));
+    printLatency("Migration Batch Latency (ns):", migration_batch_latency_);
+    printMigrationBatches(counters);
+    printPhaseRecovery();
+    printRequestLatency();
+    static const char* const tier_names[] = { "DRAM", "PMEM" };
+    printLatencyBreakdown(tier_names, 2);
 
-    if (total_latency_.load() > 0) {
+    if (counters[TOTAL_LATENCY] > 0) {
         LOG_INFO("Throughput:");
-        uint64_t total_access = local_access_count_.load() + pmem_access_count_.load();
-        double throughput = static_cast<double>(total_access) * 1e9 / static_cast<double>(total_latency_.load());
+        uint64_t total_access = counters[LOCAL_ACCESS] + counters[PMEM_ACCESS];
+        double throughput = static_cast<double>(total_access) * 1e9 / static_cast<double>(counters[TOTAL_LATENCY]);
         LOG_INFO("  Throughput: " << throughput << " ops/sec");
+        LOG_INFO("  Wall-clock: " << wallClockRate(total_access) << " ops/sec");
     }
     LOG_INFO("==========================================");
 }
 
 void Metrics::reset() {
-    local_access_count_ = 0;
-    remote_access_count_ = 0;
-    pmem_access_count_ = 0;
-    local_to_remote_count_ = 0;
-    remote_to_local_count_ = 0;
-    pmem_to_remote_count_ = 0;
-    remote_to_pmem_count_ = 0;
-    local_to_pmem_count_ = 0;
-    pmem_to_local_count_ = 0;
-    total_latency_ = 0;
-    access_latency_ = AccumulatorType{ acc::tag::extended_p_square::probabilities = probabilities };
-    migration_latency_ = AccumulatorType{ acc::tag::extended_p_square::probabilities = probabilities };
+    for (CounterShard* shard = counter_shards_.load(); shard != nullptr; shard = shard->next) {
+        for (auto& value : shard->values) {
+            value.store(0, std::memory_order_relaxed);
+        }
+    }
+    pending_shift_ns_ = 0;
+    {
+        boost::lock_guard<boost::mutex> recovery_lock(recovery_mutex_);
+        recovery_ = RecoveryTracker();
+    }
+    start_time_ns_ = get_time_ns();
+    access_latency_.reset();
+    migration_batch_latency_.reset();
+    request_latency_.reset();
+    for (size_t i = 0; i < NUM_PAGE_LAYERS + num_clients_; ++i) {
+        LatencyBreakdown& breakdown = (i < NUM_PAGE_LAYERS) ? tier_breakdown_[i] : client_breakdown_[i - NUM_PAGE_LAYERS];
+        breakdown.queue_wait.reset();
+        breakdown.service.reset();
+        breakdown.end_to_end.reset();
+    }
 }
\ No newline at end of file
@@ -0,0 +1,135 @@
+#include "MetricsSampler.hpp"
+#include "Logger.hpp"
+
+#include <cmath>
+#include <cstring>
+
+/**
+ * Counter reported as a per-interval delta column
+ */
+struct CounterColumn {
+    const char* name;
+    Metrics::Counter counter;
+};
+
+static const CounterColumn THREE_TIER_COLUMNS[] = {
+    { "local_access", Metrics::LOCAL_ACCESS },
+    { "remote_access", Metrics::REMOTE_ACCESS },
+    { "pmem_access", Metrics::PMEM_ACCESS },
+    { "migrating_access", Metrics::MIGRATING_ACCESS },
+    { "local_to_remote", Metrics::LOCAL_TO_REMOTE },
+    { "remote_to_local", Metrics::REMOTE_TO_LOCAL },
+    { "pmem_to_remote", Metrics::PMEM_TO_REMOTE },
+    { "remote_to_pmem", Metrics::REMOTE_TO_PMEM },
+    { "local_to_pmem", Metrics::LOCAL_TO_PMEM },
+    { "pmem_to_local", Metrics::PMEM_TO_LOCAL },
+};
+
+static const CounterColumn TWO_TIER_COLUMNS[] = {
+    { "dram_access", Metrics::LOCAL_ACCESS },
+    { "pmem_access", Metrics::PMEM_ACCESS },
+    { "migrating_access", Metrics::MIGRATING_ACCESS },
+    { "dram_to_pmem", Metrics::LOCAL_TO_PMEM },
+    { "pmem_to_dram", Metrics::PMEM_TO_LOCAL },
+};
+
+static bool endsWith(const std::string& s, const char* suffix) {
+    size_t n = strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+std::unique_ptr<MetricsSampler> MetricsSampler::open(const std::string& path, size_t num_tiers) {
+    Format format = (endsWith(path, ".json") || endsWith(path, ".jsonl")) ? Format::JSON_LINES : Format::CSV;
+    std::unique_ptr<MetricsSampler> sampler(new MetricsSampler(path, format, num_tiers));
+    if (!sampler->out_) {
+        LOG_ERROR("Cannot create metrics output " << path);
+        return nullptr;
+    }
+    return sampler;
+}
+
+MetricsSampler::MetricsSampler(const std::string& path, Format format, size_t num_tiers)
+    : out_(path, std::ios::trunc), format_(format), num_tiers_(num_tiers) {
+    out_.precision(10);
+    Metrics& metrics = Metrics::getInstance();
+    start_ns_ = get_time_ns();
+    previous_ns_ = start_ns_;
+    previous_counters_ = metrics.counters();
+    previous_access_ = metrics.accessLatency().snapshot();
+    previous_migration_ = metrics.migrationBatchLatency().snapshot();
+}
+
+void MetricsSampler::sample(uint64_t now_ns, size_t request_queue, size_t migration_queue) {
+    Metrics& metrics = Metrics::getInstance();
+    Metrics::CounterSnapshot counters = metrics.counters();
+    LatencyHistogram::Snapshot access = metrics.accessLatency().snapshot();
+    LatencyHistogram::Snapshot migration = metrics.migrationBatchLatency().snapshot();
+    LatencyHistogram::Snapshot interval_access = access.since(previous_access_);
+    LatencyHistogram::Snapshot interval_migration = migration.since(previous_migration_);
+    auto delta = [&](Metrics::Counter counter) {
+        return static_cast<double>(counters[counter] - previous_counters_[counter]);
+    };
+    double interval_s = static_cast<double>(now_ns - previous_ns_) / 1e9;
+
+    Row row;
+    row.emplace_back("time_ms", std::round(static_cast<double>(now_ns - start_ns_) / 1e6));
+    row.emplace_back("interval_ms", std::round(interval_s * 1e3));
+    if (num_tiers_ == 3) {
+        for (const CounterColumn& column : THREE_TIER_COLUMNS) {
+            row.emplace_back(column.name, delta(column.counter));
+        }
+    }
+    else {
+        for (const CounterColumn& column : TWO_TIER_COLUMNS) {
+            row.emplace_back(column.name, delta(column.counter));
+        }
+    }
+    double accesses = delta(Metrics::LOCAL_ACCESS) + delta(Metrics::REMOTE_ACCESS) + delta(Metrics::PMEM_ACCESS);
+    row.emplace_back("local_hit_ratio", accesses > 0 ? delta(Metrics::LOCAL_ACCESS) / accesses : 0.0);
+    row.emplace_back("access_p50_ns", interval_access.percentile(50));
+    row.emplace_back("access_p99_ns", interval_access.percentile(99));
+    row.emplace_back("migration_batch_p50_ns", interval_migration.percentile(50));
+    row.emplace_back("migration_batch_p99_ns", interval_migration.percentile(99));
+    row.emplace_back("request_queue", static_cast<double>(request_queue));
+    row.emplace_back("migration_queue", static_cast<double>(migration_queue));
+    row.emplace_back("throughput_ops", interval_s > 0 ? accesses / interval_s : 0.0);
+
+    if (!header_written_) {
+        writeHeader(row);
+        header_written_ = true;
+    }
+    writeRow(row);
+
+    previous_ns_ = now_ns;
+    previous_counters_ = counters;
+    previous_access_ = std::move(access);
+    previous_migration_ = std::move(migration);
+}
+
+void MetricsSampler::writeHeader(const Row& row) {
+    if (format_ != Format::CSV) {
+        return;
+    }
+    for (size_t i = 0; i < row.size(); ++i) {
+        out_ << (i > 0 ? "," : "") << row[i].first;
+    }
+    out_ << '\n';
+}
+
+void MetricsSampler::writeRow(const Row& row) {
+    if (format_ == Format::CSV) {
+        for (size_t i = 0; i < row.size(); ++i) {
+            out_ << (i > 0 ? "," : "") << row[i].second;
+        }
+        out_ << '\n';
+    }
+    else {
+        out_ << '{';
+        for (size_t i = 0; i < row.size(); ++i) {
+            out_ << (i > 0 ? ", " : "") << '"' << row[i].first << "\": " << row[i].second;
+        }
+        out_ << "}\n";
+    }
+    // Keep the file readable while the run is still going
+    out_.flush();
+}
@@ -0,0 +1,183 @@
+#include "MigrationEngine.hpp"
+#include "Logger.hpp"
+#include "Metrics.hpp"
+#include "Utils.hpp"
+
+#include <algorithm>
+
+MigrationEngine::MigrationEngine(PageTable& page_table, const ServerRuntimeConfig& config)
+    : page_table_(page_table),
+    batch_size_(config.migration_batch_size),
+    batch_timeout_ns_(config.migration_batch_timeout_us * 1000) {
+    // Scanner threads are the only producers of move requests
+    for (size_t i = 0; i < config.migration_threads; ++i) {
+        move_page_buffers_.push_back(makeRingBuffer<MemMoveReq>(config.ring_buffer_type, config.buffer_size,
+            config.scanner_threads > 1));
+    }
+}
+
+MigrationEngine::~MigrationEngine() {
+    stop();
+}
+
+bool MigrationEngine::submit(const MemMoveReq& req, boost::chrono::nanoseconds timeout) {
+    RingBuffer<MemMoveReq>& buffer = *move_page_buffers_[req.page_id % move_page_buffers_.size()];
+    return buffer.waitPush(req, timeout);
+}
+
+size_t MigrationEngine::queueDepth() const {
+    size_t depth = 0;
+    for (const auto& buffer : move_page_buffers_) {
+        depth += buffer->size();
+    }
+    return depth;
+}
+
+void MigrationEngine::start() {
+    running_ = true;
+    for (size_t i = 0; i < move_page_buffers_.size(); ++i) {
+        workers_.create_thread(boost::bind(&MigrationEngine::runWorker, this, i));
+    }
+}
+
+void MigrationEngine::stop() {
+    running_ = false;
+    workers_.join_all();
+}
+
+void MigrationEngine::runWorker(size_t worker_id) {
+    RingBuffer<MemMoveReq>& move_page_buffer = *move_page_buffers_[worker_id];
+    std::vector<MemMoveReq> reqs(batch_size_);
+    std::vector<PendingBatch> pending(NUM_PAGE_LAYERS);     // Indexed by destination layer
+
+    while (running_) {
+        // Park for new requests, but no longer than the oldest pending batch may still wait
+        uint64_t now = get_time_ns();
+        uint64_t wait_ns = 1000000;
+        for (const PendingBatch& batch : pending) {
+            if (!batch.pages.empty()) {
+                uint64_t deadline = batch.oldest_ns + batch_timeout_ns_;
+                wait_ns = std::min(wait_ns, deadline > now ? deadline - now : 0);
+            }
+        }
+        size_t count = move_page_buffer.waitPopBatch(reqs.data(), reqs.size(), boost::chrono::nanoseconds(wait_ns));
+        for (size_t i = 0; i < count; ++i) {
+            enqueue(reqs[i], pending);
+        }
+
+        // Submit batches whose time limit expired
+        now = get_time_ns();
+        for (size_t layer = 0; layer < NUM_PAGE_LAYERS; ++layer) {
+            PendingBatch& batch = pending[layer];
+            if (!batch.pages.empty() && now - batch.oldest_ns >= batch_timeout_ns_) {
+                flush(static_cast<PageLayer>(layer), batch);
+            }
+        }
+    }
+
+    // Submit what is left so no page stays flagged as migrating
+    for (size_t layer = 0; layer < NUM_PAGE_LAYERS; ++layer) {
+        if (!pending[layer].pages.empty()) {
+            flush(static_cast<PageLayer>(layer), pending[layer]);
+        }
+    }
+    LOG_DEBUG("Migration worker " << worker_id << " exiting...");
+}
+
+void MigrationEngine::enqueue(const MemMoveReq& req, std::vector<PendingBatch>& pending) {
+    LOG_DEBUG("Migration worker received move request: " << req.toString());
+
+    size_t page_id = req.page_id;
+    PageLayer target_node = req.layer_id;
+
+    // Only the request the page is still queued for may move it; cancelled
+    // or superseded requests are dropped here
+    if (!page_table_.beginMigration(page_id, target_node)) {
+        LOG_DEBUG("Dropping stale move request for Page " << page_id);
+        return;
+    }
+
+    PageMetadata page_meta = page_table_.getPage(page_id);
+    PageLayer current_node = page_meta.page_layer;
+
+    if (current_node == target_node) {
+        LOG_DEBUG("Page " << page_id << " is already on the desired layer.");
+        page_table_.abortMigration(page_id);
+        return;
+    }
+
+    // Hold a slot on the destination so the tier never exceeds its size
+    if (!page_table_.reserveSlot(target_node)) {
+        LOG_DEBUG("Layer " << target_node << " is full, dropping move of Page " << page_id);
+        Metrics::getInstance().incrementRefusedMove();
+        page_table_.abortMigration(page_id);
+        return;
+    }
+
+    PendingBatch& batch = pending[static_cast<size_t>(target_node)];
+    if (batch.pages.empty()) {
+        batch.oldest_ns = get_time_ns();
+    }
+    batch.page_ids.push_back(page_id);
+    batch.pages.push_back(page_table_.pageAddress(page_meta));
+    batch.sources.push_back(current_node);
+
+    // Submit as soon as the batch reaches its size limit
+    if (batch.pages.size() >= batch_size_) {
+        flush(target_node, batch);
+    }
+}
+
+void MigrationEngine::flush(PageLayer target, PendingBatch& batch) {
+    size_t count = batch.pages.size();
+    int target_node = tier_to_node(target);
+    batch.nodes.assign(count, target_node);
+    batch.status.assign(count, 0);
+
+    // Perform the migration of the whole batch; virtual addresses stay valid while the kernel moves the frames
+    LOG_DEBUG("Moving " << count << " pages to Node " << target << "...");
+    uint64_t batch_time = move_pages_batch(batch.pages.data(), batch.nodes.data(), batch.status.data(), count);
+    Metrics::getInstance().recordMigrationBatch(batch_time, count);
+    LOG_DEBUG("Batch migration time: " << batch_time << " ns");
+
+    for (size_t i = 0; i < count; ++i) {
+        size_t page_id = batch.page_ids[i];
+        PageLayer current_node = batch.sources[i];
+
+        if (batch.status[i] != target_node) {
+            LOG_DEBUG("Failed to move Page " << page_id << ": status " << batch.status[i]);
+            Metrics::getInstance().incrementMigrationFailure();
+            page_table_.releaseSlot(target);
+            page_table_.abortMigration(page_id);
+            continue;
+        }
+
+        if (current_node == PageLayer::NUMA_LOCAL && target == PageLayer::NUMA_REMOTE) {
+            Metrics::getInstance().incrementLocalToRemote();
+        }
+        else if (current_node == PageLayer::NUMA_REMOTE && target == PageLayer::NUMA_LOCAL) {
+            Metrics::getInstance().incrementRemoteToLocal();
+        }
+        else if (current_node == PageLayer::PMEM && target == PageLayer::NUMA_REMOTE) {
+            Metrics::getInstance().incrementPmemToRemote();
+        }
+        else if (current_node == PageLayer::NUMA_REMOTE && target == PageLayer::PMEM) {
+            Metrics::getInstance().incrementRemoteToPmem();
+        }
+        else if (current_node == PageLayer::NUMA_LOCAL && target == PageLayer::PMEM) {
+            Metrics::getInstance().incrementLocalToPmem();
+        }
+        else if (current_node == PageLayer::PMEM && target == PageLayer::NUMA_LOCAL) {
+            Metrics::getInstance().incrementPmemToLocal();
+        }
+
+        // After the move, publish the new page layer in the PageTable
+        page_table_.finishMigration(page_id, target);
+        page_table_.releaseSlot(current_node);
+        LOG_DEBUG("Page " << page_id << " now on Layer " << target);
+    }
+
+    batch.page_ids.clear();
+    batch.pages.clear();
+    batch.sources.clear();
+}
@@ -1,15 +1,33 @@
 #include "PageTable.hpp"
 #include "Logger.hpp"
 
-PageMetadata::PageMetadata(void* addr, PageLayer layer)
-    : page_address(addr),
-    page_layer(layer),
-    last_access_time(boost::chrono::steady_clock::now()),
-    access_count(0)
-{
+#include <algorithm>
+
+PageTable::PageTable(size_t size) {
+    for (size_t region = 0; region < NUM_REGIONS; ++region) {
+        tier_pages_[region].store(0, std::memory_order_relaxed);
+    }
+    resize(size);
+}
+
+void PageTable::resize(size_t size) {
+    size_ = size;
+    page_flags_.reset(new std::atomic<uint8_t>[size]);
+    page_frame_.reset(new std::atomic<uint32_t>[size]);
+    access_count_.reset(new std::atomic<uint32_t>[size]);
+    last_access_epoch_.reset(new std::atomic<uint32_t>[size]);
+    for (size_t i = 0; i < size; ++i) {
+        page_flags_[i].store(packFlags(PageLayer::NUMA_LOCAL, PageState::RESIDENT, PageLayer::NUMA_LOCAL), std::memory_order_relaxed);
+        page_frame_[i].store(0, std::memory_order_relaxed);
+        access_count_[i].store(0, std::memory_order_relaxed);
+        last_access_epoch_[i].store(0, std::memory_order_relaxed);
+    }
 }
 
-PageTable::PageTable(size_t size) : table_(size) {}
+void* PageTable::frameAddress(uint32_t frame) const {
+    size_t region = (frame >= region_first_frame_[2]) ? 2 : (frame >= region_first_frame_[1]) ? 1 : 0;
+    return static_cast<char*>(region_base_[region]) + static_cast<size_t>(frame - region_first_frame_[region]) * PAGE_SIZE;
+}
 
 void PageTable::initPageTable(const std::vector<size_t>& client_addr_space, const ServerMemoryConfig& server_config,
     void* local_base, void* remote_base, void* pmem_base) {
@@ -20,12 +38,9 @@ void PageTable::initPageTable(const std::vector<size_t>& client_addr_space, cons
     }
 
     LOG_DEBUG("Total pages required by clients: " << total_pages);
-    // Lock the table for write
-    boost::unique_lock<boost::shared_mutex> lock(mutex_);
 
     // Clear and resize the table to hold all required pages
-    table_.clear();
-    table_.resize(total_pages);
+    resize(total_pages);
 
     // Extract server capacities
     size_t local_capacity = server_config.local_numa_size;
@@ -36,6 +51,21 @@ void PageTable::initPageTable(const std::vector<size_t>& client_addr_space, cons
     LOG_DEBUG("Server capacities - Local NUMA: " << local_capacity << ", Remote NUMA: " << remote_capacity 
             << ", PMEM: " << pmem_capacity << ", Tiers: " << num_tiers);
 
+    // Lay out frame ranges of the memory regions; with two tiers the local
+    // region holds both NUMA capacities and the remote region is empty
+    size_t local_region = (num_tiers == 2) ? local_capacity + remote_capacity : local_capacity;
+    size_t remote_region = (num_tiers == 2) ? 0 : remote_capacity;
+    region_base_[0] = local_base;
+    region_base_[1] = remote_base;
+    region_base_[2] = pmem_base;
+    region_first_frame_[0] = 0;
+    region_first_frame_[1] = static_cast<uint32_t>(local_region);
+    region_first_frame_[2] = static_cast<uint32_t>(local_region + remote_region);
+    region_first_frame_[3] = static_cast<uint32_t>(local_region + remote_region + pmem_capacity);
+    tier_capacity_[0] = local_region;
+    tier_capacity_[1] = remote_region;
+    tier_capacity_[2] = pmem_capacity;
+
     // Compute per-client allocation for NUMA_LOCAL
     std::vector<size_t> local_allocation(client_addr_space.size(), 0);
     std::vector<size_t> remote_allocation(client_addr_space.size(), 0);
@@ -109,81 +139,183 @@ void PageTable::initPageTable(const std::vector<size_t>& client_addr_space, cons
     size_t remote_offset_pages = 0;
     size_t pmem_offset_pages = 0;
 
-    auto fillPages = [&](PageLayer layer, size_t count, void* base, size_t& offset) {
+    uint32_t now = currentEpoch();
+
+    auto fillPages = [&](PageLayer layer, size_t count, size_t& offset) {
+        size_t region = static_cast<size_t>(layer);
         for (size_t i = 0; i < count; ++i) {
-            char* addr = static_cast<char*>(base) + offset * PAGE_SIZE;
-            table_[current_index] = PageMetadata(static_cast<void*>(addr), layer);
+            page_flags_[current_index].store(packFlags(layer, PageState::RESIDENT, layer), std::memory_order_relaxed);
+            page_frame_[current_index].store(region_first_frame_[region] + static_cast<uint32_t>(offset), std::memory_order_relaxed);
+            access_count_[current_index].store(0, std::memory_order_relaxed);
+            last_access_epoch_[current_index].store(now, std::memory_order_relaxed);
             current_index++;
             offset++;
         }
+        tier_pages_[region].fetch_add(count, std::memory_order_relaxed);
         LOG_DEBUG("Filled " << count << " pages for layer " << static_cast<int>(layer));
         };
 
     for (size_t client_id = 0; client_id < client_addr_space.size(); ++client_id) {
-        fillPages(PageLayer::NUMA_LOCAL, local_allocation[client_id], local_base, local_offset_pages);
-        fillPages(PageLayer::NUMA_REMOTE, remote_allocation[client_id], remote_base, remote_offset_pages);
-        fillPages(PageLayer::PMEM, pmem_allocation[client_id], pmem_base, pmem_offset_pages);
+        fillPages(PageLayer::NUMA_LOCAL, local_allocation[client_id], local_offset_pages);
+        fillPages(PageLayer::NUMA_REMOTE, remote_allocation[client_id], remote_offset_pages);
+        fillPages(PageLayer::PMEM, pmem_allocation[client_id], pmem_offset_pages);
+    }
+}
+
+PageMetadata PageTable::readPage(size_t index) const {
+    PageMetadata page;
+    uint8_t flags = page_flags_[index].load(std::memory_order_acquire);
+    page.page_layer = static_cast<PageLayer>(flags & LAYER_MASK);
+    page.page_state = static_cast<PageState>((flags >> STATE_SHIFT) & 0x3);
+    page.migration_target = static_cast<PageLayer>((flags >> (STATE_SHIFT + 2)) & 0x3);
+    page.frame = page_frame_[index].load(std::memory_order_relaxed);
+    page.access_count = access_count_[index].load(std::memory_order_relaxed);
+    page.last_access_epoch = last_access_epoch_[index].load(std::memory_order_relaxed);
+    return page;
+}
+
+void PageTable::storeLayer(size_t index, PageLayer layer) {
+    uint8_t flags = page_flags_[index].load(std::memory_order_relaxed);
+    while (!page_flags_[index].compare_exchange_weak(flags,
+        static_cast<uint8_t>((flags & ~LAYER_MASK) | static_cast<uint8_t>(layer)), std::memory_order_release)) {
     }
 }
 
 PageMetadata PageTable::getPage(size_t index) const {
-    boost::shared_lock<boost::shared_mutex> lock(mutex_);
-    if (index < table_.size()) {
-        return table_[index];
+    if (index < size_) {
+        return readPage(index);
     }
     return PageMetadata();
 }
 
-size_t PageTable::getNextPageId() const {
-    return current_index_;
+size_t PageTable::size() const {
+    return size_;
 }
 
-size_t PageTable::size() const {
-    boost::shared_lock<boost::shared_mutex> lock(mutex_);
-    return table_.size();
+ClassifyMasks PageTable::classifyBlock(size_t begin, size_t count, uint32_t hot_threshold, uint32_t cold_interval,
+    uint32_t now) const {
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) && std::atomic<uint32_t>::is_always_lock_free,
+        "atomic counters must be plain words");
+    ClassifyMasks masks;
+    if (begin >= size_) {
+        return masks;
+    }
+    count = std::min(count, size_ - begin);
+    // Idle for at least cold_interval means last access before now - cold_interval + 1
+    uint32_t cold_before = (now >= cold_interval) ? now - cold_interval + 1 : 0;
+    classifyPages(reinterpret_cast<const uint32_t*>(&access_count_[begin]),
+        reinterpret_cast<const uint32_t*>(&last_access_epoch_[begin]), count, hot_threshold, cold_before, masks);
+    return masks;
 }
 
 void PageTable::updatePage(size_t index, const PageMetadata& metadata) {
-    boost::unique_lock<boost::shared_mutex> lock(mutex_);
-    if (index < table_.size()) {
-        table_[index] = metadata;
+    if (index < size_) {
+        storeLayer(index, metadata.page_layer);
+        page_frame_[index].store(metadata.frame, std::memory_order_relaxed);
+        access_count_[index].store(metadata.access_count, std::memory_order_relaxed);
+        last_access_epoch_[index].store(metadata.last_access_epoch, std::memory_order_relaxed);
     }
 }
 
 void PageTable::updateAccess(size_t index) {
-    boost::unique_lock<boost::shared_mutex> lock(mutex_);
-    if (index < table_.size()) {
-        table_[index].last_access_time = boost::chrono::steady_clock::now();
-        table_[index].access_count++;
+    if (index < size_) {
+        last_access_epoch_[index].store(currentEpoch(), std::memory_order_relaxed);
+        // Saturate instead of wrapping a hot page back to cold
+        if (access_count_[index].load(std::memory_order_relaxed) != UINT32_MAX) {
+            access_count_[index].fetch_add(1, std::memory_order_relaxed);
+        }
     }
 }
 
 void PageTable::updatePageLayer(size_t index, PageLayer new_layer) {
-    boost::unique_lock<boost::shared_mutex> lock(mutex_);
-    if (index < table_.size()) {
-        table_[index].page_layer = new_layer;
-        table_[index].last_access_time = boost::chrono::steady_clock::now();
-        table_[index].access_count++;
+    if (index < size_) {
+        storeLayer(index, new_layer);
+        updateAccess(index);
     }
 }
 
-PageMetadata PageTable::scanNext() {
-    boost::unique_lock<boost::shared_mutex> lock(mutex_);
+void PageTable::decayAccessCounts(size_t begin, size_t count, unsigned shift) {
+    size_t end = std::min(begin + count, size_);
+    for (size_t i = begin; i < end; ++i) {
+        uint32_t value = access_count_[i].load(std::memory_order_relaxed);
+        // Subtracting keeps increments that race with the decay; idle pages
+        // are skipped so their cache lines stay clean
+        if (value != 0) {
+            access_count_[i].fetch_sub(value - (value >> shift), std::memory_order_relaxed);
+        }
+    }
+}
 
-    if (table_.empty()) {
-        return PageMetadata(); // Handle empty table case
+bool PageTable::reserveSlot(PageLayer layer) {
+    size_t region = static_cast<size_t>(layer);
+    size_t pages = tier_pages_[region].load(std::memory_order_relaxed);
+    do {
+        if (pages >= tier_capacity_[region]) {
+            return false;
+        }
+    } while (!tier_pages_[region].compare_exchange_weak(pages, pages + 1, std::memory_order_relaxed));
+    return true;
+}
+
+void PageTable::releaseSlot(PageLayer layer) {
+    tier_pages_[static_cast<size_t>(layer)].fetch_sub(1, std::memory_order_relaxed);
+}
+
+size_t PageTable::tierPages(PageLayer layer) const {
+    return tier_pages_[static_cast<size_t>(layer)].load(std::memory_order_relaxed);
+}
+
+size_t PageTable::tierCapacity(PageLayer layer) const {
+    return tier_capacity_[static_cast<size_t>(layer)];
+}
+
+bool PageTable::transitionState(size_t index, uint8_t expected, uint8_t desired) {
+    if (index >= size_) {
+        return false;
     }
+    uint8_t flags = page_flags_[index].load(std::memory_order_relaxed);
+    do {
+        if ((flags >> STATE_SHIFT) != expected) {
+            return false;
+        }
+    } while (!page_flags_[index].compare_exchange_weak(flags,
+        static_cast<uint8_t>((flags & LAYER_MASK) | (desired << STATE_SHIFT)), std::memory_order_acq_rel));
+    return true;
+}
 
-    // Return the current page and move to the next index (circularly)
-    PageMetadata page = table_[current_index_];
-    current_index_ = (current_index_ + 1) % table_.size(); // Wrap around using modulo
+bool PageTable::queueMigration(size_t index, PageLayer target) {
+    if (index >= size_) {
+        return false;
+    }
+    // The target bits of a resident page are leftovers, so accept any
+    uint8_t expected = page_flags_[index].load(std::memory_order_relaxed) >> STATE_SHIFT;
+    if ((expected & 0x3) != static_cast<uint8_t>(PageState::RESIDENT)) {
+        return false;
+    }
+    return transitionState(index, expected, packState(PageState::QUEUED, target));
+}
 
-    return page;
+bool PageTable::cancelMigration(size_t index, PageLayer target) {
+    return transitionState(index, packState(PageState::QUEUED, target), packState(PageState::RESIDENT, target));
+}
+
+bool PageTable::beginMigration(size_t index, PageLayer target) {
+    return transitionState(index, packState(PageState::QUEUED, target), packState(PageState::MIGRATING, target));
 }
 
-void PageTable::resetAccessCount() {
-    boost::unique_lock<boost::shared_mutex> lock(mutex_);
-    for (auto& page : table_) {
-        page.access_count = 0; // Reset access count
+void PageTable::finishMigration(size_t index, PageLayer new_layer) {
+    if (index < size_) {
+        page_flags_[index].store(packFlags(new_layer, PageState::RESIDENT, new_layer), std::memory_order_release);
+        updateAccess(index);
     }
-}
\ No newline at end of file
+}
+
+void PageTable::abortMigration(size_t index) {
+    if (index < size_) {
+        uint8_t flags = page_flags_[index].load(std::memory_order_relaxed);
+        while (!page_flags_[index].compare_exchange_weak(flags,
+            static_cast<uint8_t>((flags & LAYER_MASK) | (packState(PageState::RESIDENT, PageLayer::NUMA_LOCAL) << STATE_SHIFT)),
+            std::memory_order_release)) {
+        }
+    }
+}
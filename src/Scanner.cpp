@@ -1,109 +1,165 @@
 #include "Scanner.hpp"
 #include "Logger.hpp"
 #include "Server.hpp"
+#include "Metrics.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <boost/chrono.hpp>
 #include <boost/thread/thread.hpp> 
 
-Scanner::Scanner(PageTable& page_table)
-    : page_table_(page_table), running_(false) {
+Scanner::Scanner(PageTable& page_table, MigrationEngine& migration_engine, TieringPolicy& policy, size_t num_threads)
+    : page_table_(page_table), migration_engine_(migration_engine), policy_(policy), num_threads_(num_threads),
+    running_(false) {
 }
 
-// Check if a page is hot based on both access count and time threshold
-bool Scanner::classifyHotPage(const PageMetadata& page, size_t min_access_count) const {
-    return page.access_count >= min_access_count;
+bool Scanner::submitMoveRequest(const MemMoveReq& req) {
+    while (running_) {
+        if (migration_engine_.submit(req, boost::chrono::milliseconds(1))) {
+            return true;
+        }
+    }
+    return false;
 }
 
-// Check if a page is cold based on both access count and time threshold
-bool Scanner::classifyColdPage(const PageMetadata& page, boost::chrono::milliseconds time_threshold) const {
-    auto current_time = boost::chrono::steady_clock::now();
-    auto time_since_last_access = boost::chrono::duration_cast<boost::chrono::milliseconds>(
-        current_time - page.last_access_time);
-    return time_since_last_access >= time_threshold;
+void Scanner::requestMove(size_t page_id, PageLayer target) {
+    if (!page_table_.queueMigration(page_id, target)) {
+        return;
+    }
+    if (!submitMoveRequest(MemMoveReq(page_id, target))) {
+        // Stopped before the request was handed over
+        page_table_.cancelMigration(page_id, target);
+    }
 }
 
-// Continuously classify pages using scanNext()
-void Scanner::runClassifier(RingBuffer<MemMoveReq>& move_page_buffer, size_t min_access_count, boost::chrono::milliseconds time_threshold, size_t num_tiers) {
-    running_ = true;
-    while (running_) {
-        size_t page_id = page_table_.getNextPageId();
-        PageMetadata page = page_table_.scanNext();
-
-        switch (page.page_layer) {
-        case PageLayer::NUMA_LOCAL: {
-            if (num_tiers == 2) {
-                // For two tiers, treat NUMA_LOCAL and NUMA_REMOTE as a single DRAM tier
-                if (classifyColdPage(page, time_threshold)) {
-                    LOG_DEBUG("Cold page detected in DRAM: " << page.page_address);
-                    MemMoveReq msg(page_id, PageLayer::PMEM);
-                    while (!move_page_buffer.push(msg)) {
-                        boost::this_thread::sleep_for(boost::chrono::nanoseconds(100));
-                    }
-                }
-            }
-            else {
-                // For three tiers, handle NUMA_LOCAL cold pages
-                // Only detect cold pages for local NUMA
-                if (classifyColdPage(page, time_threshold)) {
-                    LOG_DEBUG("Cold page detected in NUMA_LOCAL: " << page.page_address);
-                    MemMoveReq msg(page_id, PageLayer::NUMA_REMOTE);
-                    while (!move_page_buffer.push(msg)) {
-                        boost::this_thread::sleep_for(boost::chrono::nanoseconds(100));
-                    }
-                }
-            }
-            break;
+// Next slower layer a page of a fast tier is demoted to
+PageLayer Scanner::demotionTarget(PageLayer layer, size_t num_tiers) const {
+    if (layer == PageLayer::NUMA_LOCAL && num_tiers == 3) {
+        return PageLayer::NUMA_REMOTE;
+    }
+    return PageLayer::PMEM;
+}
+
+// Start a pass over a range: set how many pages each fast tier must shed from it
+void Scanner::beginPass(ScanRange& range) {
+    range.previous_pass_epoch = range.pass_epoch;
+    range.pass_epoch = page_table_.currentEpoch();
+
+    for (size_t layer = 0; layer < NUM_PAGE_LAYERS; ++layer) {
+        range.reclaim_budget[layer] = 0;
+    }
+    PageLayer fast_tiers[] = { PageLayer::NUMA_LOCAL, PageLayer::NUMA_REMOTE };
+    for (size_t i = 0; i < num_tiers_ - 1; ++i) {
+        PageLayer layer = fast_tiers[i];
+        size_t capacity = page_table_.tierCapacity(layer);
+        size_t pages = page_table_.tierPages(layer);
+        // Above the high watermark, demote down to the low watermark; every range sheds an equal share
+        if (capacity > 0 && pages >= policy_config_.high_watermark * capacity) {
+            size_t low = static_cast<size_t>(policy_config_.low_watermark * capacity);
+            size_t excess = pages - std::min(pages, low);
+            range.reclaim_budget[static_cast<size_t>(layer)] = (excess + num_threads_ - 1) / num_threads_;
+            LOG_DEBUG("Layer " << layer << " above high watermark (" << pages << "/" << capacity
+                << "), reclaiming " << excess << " pages");
         }
+    }
+}
 
-        case PageLayer::NUMA_REMOTE: {
-            // Check cold first, then hot if not cold
-            if (classifyColdPage(page, time_threshold)) {
-                LOG_DEBUG("Cold page detected in NUMA_REMOTE: " << page.page_address);
-                MemMoveReq msg(page_id, PageLayer::PMEM);
-                while (!move_page_buffer.push(msg)) {
-                    boost::this_thread::sleep_for(boost::chrono::nanoseconds(100));
-                }
-            }
-            else if (classifyHotPage(page, min_access_count)) {
-                LOG_DEBUG("Hot page detected in NUMA_REMOTE: " << page.page_address);
-                MemMoveReq msg(page_id, PageLayer::NUMA_LOCAL);
-                while (!move_page_buffer.push(msg)) {
-                    boost::this_thread::sleep_for(boost::chrono::nanoseconds(100));
-                }
-            }
-            break;
+void Scanner::scanPage(size_t page_id, const ScanBlock& block, ScanRange& range) {
+    PageMetadata page = page_table_.getPage(page_id);
+
+    PageLayer target = page.page_layer;
+    bool move = policy_.onScan(page_id, page, block, target);
+
+    // A promotion into a full tier is refused and paired with a demotion
+    // of a reclaim victim from that tier later in the pass
+    if (move && target < page.page_layer
+        && page_table_.tierPages(target) >= page_table_.tierCapacity(target)) {
+        LOG_DEBUG("Layer " << target << " is full, deferring promotion of Page " << page_id);
+        Metrics::getInstance().incrementRefusedMove();
+        range.reclaim_budget[static_cast<size_t>(target)]++;
+        move = false;
+    }
+
+    // Reclaim: demote the pages the policy picks as victims
+    size_t& budget = range.reclaim_budget[static_cast<size_t>(page.page_layer)];
+    if (budget > 0 && page.page_layer != PageLayer::PMEM && page.page_state == PageState::RESIDENT) {
+        if (move && target > page.page_layer) {
+            budget--;
         }
+        else if (!move && policy_.reclaimable(page_id, page, range.previous_pass_epoch)) {
+            target = demotionTarget(page.page_layer, num_tiers_);
+            move = true;
+            budget--;
+            Metrics::getInstance().incrementReclaimDemotion();
+        }
+    }
 
-        case PageLayer::PMEM: {
-            // Only detect hot pages for PMEM
-            LOG_DEBUG("Hot page detected in PMEM: " << page.page_address);
-            if (classifyHotPage(page, min_access_count)) {
-                if (num_tiers == 2) {
-                    // Move hot pages from PMEM to DRAM in a two-tier setup
-                    MemMoveReq msg(page_id, PageLayer::NUMA_LOCAL);
-                    while (!move_page_buffer.push(msg)) {
-                        boost::this_thread::sleep_for(boost::chrono::nanoseconds(100));
-                    }
-                }
-                else {
-                    // Move hot pages from PMEM to NUMA_REMOTE in a three-tier setup
-                    MemMoveReq msg(page_id, PageLayer::NUMA_REMOTE);
-                    while (!move_page_buffer.push(msg)) {
-                        boost::this_thread::sleep_for(boost::chrono::nanoseconds(100));
-                    }
-                }
-            }
+    switch (page.page_state) {
+    case PageState::RESIDENT:
+        if (move) {
+            requestMove(page_id, target);
+        }
+        break;
+
+    case PageState::QUEUED:
+        // A request is already pending; keep it unless the decision changed
+        if (move && target == page.migration_target) {
             break;
         }
+        if (page_table_.cancelMigration(page_id, page.migration_target)) {
+            LOG_DEBUG("Cancelled move of Page " << page_id << " to Layer " << page.migration_target);
+            Metrics::getInstance().incrementCancelledMove();
+            if (move) {
+                requestMove(page_id, target);
+            }
         }
+        break;
 
-        // Sleep for a short duration after whole table iteration
-        if (page_id == page_table_.size() - 1) {
-            boost::this_thread::sleep_for(boost::chrono::milliseconds(100));
-            LOG_DEBUG("Finished scanning all pages in one round!");
+    case PageState::MIGRATING:
+        // Too late to change course; look again next pass
+        break;
+    }
+}
+
+// Repeatedly classify the pages of one contiguous range
+void Scanner::runRange(size_t begin, size_t end) {
+    ScanRange range;
+    ScanBlock block;
+    while (running_) {
+        beginPass(range);
+        for (block.begin = begin; block.begin < end && running_; block.begin += block.count) {
+            // Classify a block of pages at once, reading the clock only once
+            block.count = std::min(ScanBlock::MAX_PAGES, end - block.begin);
+            block.epoch = page_table_.currentEpoch();
+            policy_.classifyBlock(block);
+            for (size_t page_id = block.begin; page_id < block.begin + block.count; ++page_id) {
+                scanPage(page_id, block, range);
+            }
+            // Age the counters once the block has been judged on them
+            if (policy_config_.access_decay_shift > 0 && policy_.usesAccessCounts()) {
+                page_table_.decayAccessCounts(block.begin, block.count, policy_config_.access_decay_shift);
+            }
         }
+
+        // Sleep for a short duration after whole range iteration
+        boost::this_thread::sleep_for(boost::chrono::milliseconds(100));
+        LOG_DEBUG("Finished scanning pages [" << begin << ", " << end << ") in one round!");
+    }
+}
+
+// Continuously classify pages, one thread per contiguous range of the table
+void Scanner::runClassifier(const PolicyConfig& policy, size_t num_tiers) {
+    policy_config_ = policy;
+    num_tiers_ = num_tiers;
+    running_ = true;
+
+    size_t range_size = (page_table_.size() + num_threads_ - 1) / num_threads_;
+    boost::thread_group threads;
+    for (size_t begin = 0; begin < page_table_.size(); begin += range_size) {
+        size_t end = std::min(begin + range_size, page_table_.size());
+        threads.create_thread(boost::bind(&Scanner::runRange, this, begin, end));
     }
+    threads.join_all();
 }
 
 
@@ -6,9 +6,9 @@
 #include <boost/chrono.hpp>
 #include <boost/thread/thread.hpp> 
 
-Server::Server(RingBuffer<ClientMessage>& client_buffer, RingBuffer<MemMoveReq>& move_page_buffer,
-    const std::vector<size_t>& client_addr_space, const ServerMemoryConfig& server_config, const PolicyConfig& policy_config)
-    : client_buffer_(client_buffer), move_page_buffer_(move_page_buffer), server_config_(server_config), policy_config_(policy_config) {
+Server::Server(const std::vector<size_t>& client_addr_space, const ServerMemoryConfig& server_config, const PolicyConfig& policy_config,
+    const ServerRuntimeConfig& runtime_config)
+    : server_config_(server_config), policy_config_(policy_config), runtime_config_(runtime_config) {
     // Calculate base addresses for each client
     size_t current_base = 0;
     for (size_t size : client_addr_space) {
@@ -16,12 +16,23 @@ Server::Server(RingBuffer<ClientMessage>& client_buffer, RingBuffer<MemMoveReq>&
         current_base += size;
     }
 
+    // Split the global page id space into one contiguous shard per manager worker
+    size_t num_workers = runtime_config_.manager_threads;
+    shard_map_.shard_size = std::max<size_t>(1, (current_base + num_workers - 1) / num_workers);
+
+    // Clients share each shard's request buffer
+    for (size_t i = 0; i < num_workers; ++i) {
+        client_buffers_.push_back(makeRingBuffer<ClientMessage>(runtime_config_.ring_buffer_type, runtime_config_.buffer_size,
+            client_addr_space.size() > 1));
+    }
+
     // Initialize flags for each client
-    client_done_flags_ = std::vector<bool>(client_addr_space.size(), false);
+    client_done_flags_ = std::vector<std::vector<bool>>(num_workers, std::vector<bool>(client_addr_space.size(), false));
+    Metrics::getInstance().setNumClients(client_addr_space.size());
 
     // Init PageTable with the total memory size
     page_table_ = new PageTable(current_base);
-    scanner_ = new Scanner(*page_table_);
+    migration_engine_ = new MigrationEngine(*page_table_, runtime_config_);
 
     // Allocate memory based on the server config
     allocateMemory(server_config);
@@ -30,6 +41,11 @@ Server::Server(RingBuffer<ClientMessage>& client_buffer, RingBuffer<MemMoveReq>&
 
     // Init page table of all memory tiers
     page_table_->initPageTable(client_addr_space, server_config, local_base_, remote_base_, pmem_base_);
+
+    // The policy sizes its per-page state from the initialised table
+    tiering_policy_ = makeTieringPolicy(policy_config_.policy_type, *page_table_, policy_config_, server_config.num_tiers,
+        shard_map_);
+    scanner_ = new Scanner(*page_table_, *migration_engine_, *tiering_policy_, runtime_config_.scanner_threads);
 }
 
 Server::~Server() {
@@ -109,30 +125,52 @@ void Server::generateRandomContent() {
     }
 }
 
+std::vector<RingBuffer<ClientMessage>*> Server::getClientBuffers() const {
+    std::vector<RingBuffer<ClientMessage>*> buffers;
+    for (const auto& buffer : client_buffers_) {
+        buffers.push_back(buffer.get());
+    }
+    return buffers;
+}
+
 // Helper function to handle a ClientMessage
-void Server::handleClientMessage(const ClientMessage& msg) {
+void Server::handleClientMessage(size_t worker_id, const ClientMessage& msg) {
     LOG_DEBUG("Server received: " << msg.toString());
 
     if (msg.op_type == OperationType::END) {
-        client_done_flags_[msg.client_id] = true;
-        LOG_DEBUG("Client " << msg.client_id << " sent END command.");
+        std::vector<bool>& done_flags = client_done_flags_[worker_id];
+        done_flags[msg.client_id] = true;
+        LOG_DEBUG("Client " << msg.client_id << " sent END command to worker " << worker_id << ".");
 
-        // Check if all clients are done
-        if (std::all_of(client_done_flags_.begin(), client_done_flags_.end(), [](bool done) { return done; })) {
+        // Check if all clients are done with this shard, the last worker to finish reports
+        if (std::all_of(done_flags.begin(), done_flags.end(), [](bool done) { return done; })
+            && finished_workers_.fetch_add(1) + 1 == client_buffers_.size()) {
             LOG_INFO("All clients sent END command. Printing metrics...");
             if (num_tiers_ == 3) { Metrics::getInstance().printMetricsThreeTiers(); }
             else {
                 Metrics::getInstance().printMetricsTwoTiers();
             }
+            printTierOccupancy();
+            if (!runtime_config_.latency_cdf_path.empty()) {
+                Metrics::getInstance().writeLatencyCdf(runtime_config_.latency_cdf_path);
+            }
             signalShutdown();  // Exit the server gracefully
         }
         return;
     }
 
+    uint64_t service_start = get_time_ns();
     size_t actual_id = base_page_id_[msg.client_id] + msg.offset;
     size_t page_id = static_cast<size_t>(actual_id);
     PageMetadata page_meta = page_table_->getPage(actual_id);
     page_table_->updateAccess(page_id);
+    tiering_policy_->onAccess(page_id);
+
+    // The page stays accessible while a migration worker moves it; the
+    // access is served from the source layer and counted separately
+    if (page_meta.page_state == PageState::MIGRATING) {
+        Metrics::getInstance().incrementMigratingAccess();
+    }
 
     switch (page_meta.page_layer) {
     case PageLayer::NUMA_LOCAL:
@@ -149,114 +187,151 @@ void Server::handleClientMessage(const ClientMessage& msg) {
     // record access latency
     uint64_t access_time;
     if (msg.op_type == OperationType::READ) {
-        access_time = access_page(page_meta.page_address, READ);
+        access_time = access_page(page_table_->pageAddress(page_meta), READ);
     }
     else {
-        access_time = access_page(page_meta.page_address, WRITE);
+        access_time = access_page(page_table_->pageAddress(page_meta), WRITE);
     }
     Metrics::getInstance().recordAccessLatency(access_time);
     LOG_DEBUG("Access time: " << access_time << " ns");
-}
-
-// Helper function to handle a MemMoveReq
-void Server::handleMemoryMoveRequest(const MemMoveReq& req) {
-    LOG_DEBUG("Server received move request: " << req.toString());
 
-    size_t page_id = static_cast<size_t>(req.page_id);
-    PageMetadata page_meta = page_table_->getPage(page_id);
+    uint64_t completion = get_time_ns();
+    Metrics::getInstance().recordRequestBreakdown(msg.client_id, page_meta.page_layer,
+        service_start - msg.enqueue_ns, completion - service_start);
 
-    // Determine the target NUMA node or memory layer
-    PageLayer target_node = req.layer_id;
-    PageLayer current_node = page_meta.page_layer;
-
-    if (current_node == target_node) {
-        LOG_DEBUG("Page " << page_id << " is already on the desired layer.");
-        return;
+    // Open-loop requests count from when they should have been sent
+    if (msg.intended_ns != 0) {
+        Metrics::getInstance().recordRequestLatency(completion - msg.intended_ns);
     }
+}
 
-    if (current_node == PageLayer::NUMA_LOCAL && target_node == PageLayer::NUMA_REMOTE) {
-        Metrics::getInstance().incrementLocalToRemote();
-    }
-    else if (current_node == PageLayer::NUMA_REMOTE && target_node == PageLayer::NUMA_LOCAL) {
-        Metrics::getInstance().incrementRemoteToLocal();
-    }
-    else if (current_node == PageLayer::PMEM && target_node == PageLayer::NUMA_REMOTE) {
-        Metrics::getInstance().incrementPmemToRemote();
-    }
-    else if (current_node == PageLayer::NUMA_REMOTE && target_node == PageLayer::PMEM) {
-        Metrics::getInstance().incrementRemoteToPmem();
-    }
-    else if (current_node == PageLayer::NUMA_LOCAL && target_node == PageLayer::PMEM) {
-        Metrics::getInstance().incrementLocalToPmem();
+void Server::printTierOccupancy() const {
+    LOG_INFO("Tier Occupancy (pages):");
+    if (num_tiers_ == 3) {
+        LOG_INFO("  Local Tier " << page_table_->tierPages(PageLayer::NUMA_LOCAL) << " / " << page_table_->tierCapacity(PageLayer::NUMA_LOCAL));
+        LOG_INFO("  Remote Tier " << page_table_->tierPages(PageLayer::NUMA_REMOTE) << " / " << page_table_->tierCapacity(PageLayer::NUMA_REMOTE));
     }
-    else if (current_node == PageLayer::PMEM && target_node == PageLayer::NUMA_LOCAL) {
-        Metrics::getInstance().incrementPmemToLocal();
+    else {
+        LOG_INFO("  DRAM Tier " << page_table_->tierPages(PageLayer::NUMA_LOCAL) << " / " << page_table_->tierCapacity(PageLayer::NUMA_LOCAL));
     }
-
-    // Perform the page migration
-    LOG_DEBUG("Moving Page " << page_id << " from Node " << current_node << " to Node " << target_node << "...");
-    uint64_t migrate_time = migrate_page(page_meta.page_address, current_node, target_node);
-    Metrics::getInstance().recordMigrationLatency(migrate_time);
-    LOG_DEBUG("Migration time: " << migrate_time << " ns");
-
-    // After the move, update the page layer in the PageTable
-    page_table_->updatePageLayer(page_id, req.layer_id);
-    LOG_DEBUG("Page " << page_id << " now on Layer " << req.layer_id);
+    LOG_INFO("  PMEM Tier " << page_table_->tierPages(PageLayer::PMEM) << " / " << page_table_->tierCapacity(PageLayer::PMEM));
 }
 
-void Server::runManagerThread() {
-    while (!shouldShutdown()) {
-        ClientMessage client_msg(0, 0, OperationType::READ);
-        MemMoveReq move_msg(0, PageLayer::NUMA_LOCAL);
-        bool didwork = false;
-
-        // Get memory request from client
-        if (client_buffer_.pop(client_msg)) {
-            LOG_DEBUG("Server received: " << client_msg.toString());
-            handleClientMessage(client_msg);
-            didwork = true;
-        }
+void Server::runManagerThread(size_t worker_id) {
+    RingBuffer<ClientMessage>& client_buffer = *client_buffers_[worker_id];
+    std::vector<ClientMessage> client_msgs(runtime_config_.batch_size);
 
-        // Get page move request from policy thread
-        if (move_page_buffer_.pop(move_msg)) {
-            LOG_DEBUG("Server received: " << move_msg.toString());
-            handleMemoryMoveRequest(move_msg);
-            didwork = true;
+    while (!shouldShutdown()) {
+        // Drain a batch of memory requests from clients, parking while there are none
+        size_t client_cnt = client_buffer.waitPopBatch(client_msgs.data(), client_msgs.size(), boost::chrono::milliseconds(1));
+
+        // Prefetch page metadata of the whole batch before serving it
+        for (size_t i = 0; i < client_cnt; ++i) {
+            const ClientMessage& msg = client_msgs[i];
+            if (msg.op_type != OperationType::END) {
+                page_table_->prefetch(base_page_id_[msg.client_id] + msg.offset);
+            }
         }
-
-        // Sleep if no works was done
-        if (!didwork) {
-            boost::this_thread::sleep_for(boost::chrono::nanoseconds(100));
+        for (size_t i = 0; i < client_cnt; ++i) {
+            handleClientMessage(worker_id, client_msgs[i]);
         }
     }
-    LOG_DEBUG("Manager thread exiting...");
+    LOG_DEBUG("Manager thread " << worker_id << " exiting...");
 }
 
 // Policy thread logic
 void Server::runPolicyThread() {
-    scanner_->runClassifier(move_page_buffer_, policy_config_.hot_access_cnt, boost::chrono::milliseconds(policy_config_.cold_access_interval), num_tiers_);
+    scanner_->runClassifier(policy_config_, num_tiers_);
     LOG_DEBUG("Policy thread exiting...");
 }
 
 void Server::signalShutdown() {
-    boost::lock_guard<boost::mutex> lock(shutdown_mutex_);
-    shutdown_flag_ = true;
+    shutdown_flag_.store(true, std::memory_order_release);
     scanner_->stopClassifier();
 }
 
 bool Server::shouldShutdown() {
-    boost::lock_guard<boost::mutex> lock(shutdown_mutex_);
-    return shutdown_flag_;
+    return shutdown_flag_.load(std::memory_order_acquire);
+}
+
+// Publish the page table epoch; the only thread that reads the clock for it
+void Server::runEpochTicker() {
+    boost::chrono::steady_clock::time_point start = boost::chrono::steady_clock::now();
+    boost::chrono::milliseconds epoch_length(policy_config_.epoch_ms);
+    uint32_t epoch = 0;
+    while (!shouldShutdown()) {
+        // Sleep to the next epoch boundary and derive the epoch from elapsed time so it does not drift
+        boost::this_thread::sleep_until(start + epoch_length * (epoch + 1));
+        epoch = static_cast<uint32_t>((boost::chrono::steady_clock::now() - start) / epoch_length);
+        page_table_->advanceEpoch(epoch);
+    }
+    LOG_DEBUG("Epoch ticker exiting...");
+}
+
+// Close a local hit ratio window every recovery_window_ms to time recovery from phase shifts
+void Server::runRecoveryMonitor() {
+    boost::chrono::milliseconds window(runtime_config_.recovery_window_ms);
+    boost::chrono::steady_clock::time_point next = boost::chrono::steady_clock::now() + window;
+    while (!shouldShutdown()) {
+        boost::this_thread::sleep_until(next);
+        next += window;
+        Metrics::getInstance().sampleHitRatioWindow(get_time_ns());
+    }
+    LOG_DEBUG("Recovery monitor exiting...");
+}
+
+// Append a row of metric deltas every metrics_interval_ms, and a last partial one at shutdown
+void Server::runMetricsSampler() {
+    auto sample = [this]() {
+        size_t request_queue = 0;
+        for (const auto& buffer : client_buffers_) {
+            request_queue += buffer->size();
+        }
+        metrics_sampler_->sample(get_time_ns(), request_queue, migration_engine_->queueDepth());
+    };
+    boost::chrono::milliseconds interval(runtime_config_.metrics_interval_ms);
+    boost::chrono::steady_clock::time_point next = boost::chrono::steady_clock::now() + interval;
+    while (!shouldShutdown()) {
+        // Wake up regularly so shutdown is not held up by a long interval
+        boost::this_thread::sleep_until(std::min(next, boost::chrono::steady_clock::now() + boost::chrono::milliseconds(10)));
+        if (boost::chrono::steady_clock::now() >= next) {
+            next += interval;
+            sample();
+        }
+    }
+    sample();
+    LOG_DEBUG("Metrics sampler exiting...");
 }
 
 // Main function to start threads
 void Server::start() {
-    boost::thread server_thread(&Server::runManagerThread, this);
+    Metrics::getInstance().startTimer();
+    boost::thread epoch_thread(&Server::runEpochTicker, this);
+    boost::thread recovery_thread(&Server::runRecoveryMonitor, this);
+    boost::thread sampler_thread;
+    if (!runtime_config_.metrics_output_path.empty()) {
+        metrics_sampler_ = MetricsSampler::open(runtime_config_.metrics_output_path, num_tiers_);
+        if (metrics_sampler_) {
+            sampler_thread = boost::thread(&Server::runMetricsSampler, this);
+        }
+    }
+    migration_engine_->start();
+
+    boost::thread_group manager_threads;
+    for (size_t i = 0; i < client_buffers_.size(); ++i) {
+        manager_threads.create_thread(boost::bind(&Server::runManagerThread, this, i));
+    }
     boost::thread policy_thread(&Server::runPolicyThread, this);
 
     // Join threads
-    server_thread.join();
+    manager_threads.join_all();
     policy_thread.join();
+    migration_engine_->stop();
+    epoch_thread.join();
+    recovery_thread.join();
+    if (sampler_thread.joinable()) {
+        sampler_thread.join();
+    }
 
     LOG_INFO("All threads exited. Server shutdown complete.");
 }
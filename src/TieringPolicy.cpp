@@ -0,0 +1,383 @@
+#include "TieringPolicy.hpp"
+#include "Logger.hpp"
+
+#include <algorithm>
+
+TieringPolicy::TieringPolicy(const PageTable& page_table, const PolicyConfig& config, size_t num_tiers)
+    : page_table_(page_table), config_(config), num_tiers_(num_tiers) {
+}
+
+PageLayer TieringPolicy::lowerLayer(PageLayer layer) const {
+    if (layer == PageLayer::NUMA_LOCAL && num_tiers_ == 3) {
+        return PageLayer::NUMA_REMOTE;
+    }
+    return PageLayer::PMEM;
+}
+
+bool TieringPolicy::placeByHeat(const PageMetadata& page, bool hot, bool cold, PageLayer& target) const {
+    switch (page.page_layer) {
+    case PageLayer::NUMA_LOCAL: {
+        // Only detect cold pages for local NUMA (all of DRAM with two tiers)
+        if (cold) {
+            LOG_DEBUG("Cold page detected in NUMA_LOCAL: " << "frame " << page.frame);
+            target = lowerLayer(PageLayer::NUMA_LOCAL);
+            return true;
+        }
+        break;
+    }
+
+    case PageLayer::NUMA_REMOTE: {
+        // Check cold first, then hot if not cold
+        if (cold) {
+            LOG_DEBUG("Cold page detected in NUMA_REMOTE: " << "frame " << page.frame);
+            target = PageLayer::PMEM;
+            return true;
+        }
+        else if (hot) {
+            LOG_DEBUG("Hot page detected in NUMA_REMOTE: " << "frame " << page.frame);
+            target = PageLayer::NUMA_LOCAL;
+            return true;
+        }
+        break;
+    }
+
+    case PageLayer::PMEM: {
+        // Only detect hot pages for PMEM
+        if (hot) {
+            LOG_DEBUG("Hot page detected in PMEM: " << "frame " << page.frame);
+            // Move hot pages from PMEM to DRAM in a two-tier setup, to NUMA_REMOTE in a three-tier setup
+            target = (num_tiers_ == 2) ? PageLayer::NUMA_LOCAL : PageLayer::NUMA_REMOTE;
+            return true;
+        }
+        break;
+    }
+    }
+    return false;
+}
+
+// ---------------------------------------------------------------------------
+// Threshold
+// ---------------------------------------------------------------------------
+
+void ThresholdPolicy::classifyBlock(ScanBlock& block) const {
+    block.masks = page_table_.classifyBlock(block.begin, block.count, config_.hot_access_cnt,
+        config_.cold_access_interval, block.epoch);
+}
+
+bool ThresholdPolicy::onScan(size_t page_id, const PageMetadata& page, const ScanBlock& block, PageLayer& target) {
+    return placeByHeat(page, block.hot(page_id), block.cold(page_id), target);
+}
+
+bool ThresholdPolicy::reclaimable(size_t page_id, const PageMetadata& page, uint32_t pass_epoch) {
+    (void)page_id;
+    // Not accessed since the previous pass started
+    return page.last_access_epoch < pass_epoch;
+}
+
+// ---------------------------------------------------------------------------
+// CLOCK
+// ---------------------------------------------------------------------------
+
+ClockPolicy::ClockPolicy(const PageTable& page_table, const PolicyConfig& config, size_t num_tiers)
+    : TieringPolicy(page_table, config, num_tiers),
+    referenced_(new std::atomic<uint8_t>[page_table.size()]) {
+    for (size_t i = 0; i < page_table.size(); ++i) {
+        referenced_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void ClockPolicy::onAccess(size_t page_id) {
+    // Skip the store when the bit is already set to keep the line shared
+    if (referenced_[page_id].load(std::memory_order_relaxed) == 0) {
+        referenced_[page_id].store(1, std::memory_order_relaxed);
+    }
+}
+
+bool ClockPolicy::onScan(size_t page_id, const PageMetadata& page, const ScanBlock& block, PageLayer& target) {
+    (void)block;
+    if (page.page_layer == PageLayer::NUMA_LOCAL) {
+        return false;
+    }
+    bool referenced = referenced_[page_id].exchange(0, std::memory_order_relaxed) != 0;
+    return placeByHeat(page, referenced, false, target);
+}
+
+bool ClockPolicy::reclaimable(size_t page_id, const PageMetadata& page, uint32_t pass_epoch) {
+    (void)page;
+    (void)pass_epoch;
+    // Second chance: a referenced page loses its bit and stays
+    return referenced_[page_id].exchange(0, std::memory_order_relaxed) == 0;
+}
+
+// ---------------------------------------------------------------------------
+// LRU-K
+// ---------------------------------------------------------------------------
+
+LruKPolicy::LruKPolicy(const PageTable& page_table, const PolicyConfig& config, size_t num_tiers)
+    : TieringPolicy(page_table, config, num_tiers),
+    history_(new std::atomic<uint32_t>[page_table.size() * K]) {
+    for (size_t i = 0; i < page_table.size() * K; ++i) {
+        history_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void LruKPolicy::onAccess(size_t page_id) {
+    // Shift the history by one; concurrent accesses to the same page may
+    // lose an entry, which only makes the estimate slightly stale
+    std::atomic<uint32_t>* history = &history_[page_id * K];
+    for (size_t i = K - 1; i > 0; --i) {
+        history[i].store(history[i - 1].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    history[0].store(page_table_.currentEpoch() + 1, std::memory_order_relaxed);
+}
+
+uint32_t LruKPolicy::kthAccess(size_t page_id) const {
+    return history_[page_id * K + K - 1].load(std::memory_order_relaxed);
+}
+
+void LruKPolicy::classifyBlock(ScanBlock& block) const {
+    // Only the cold mask is used; the K-th access comes from the history
+    block.masks = page_table_.classifyBlock(block.begin, block.count, UINT32_MAX,
+        config_.cold_access_interval, block.epoch);
+}
+
+bool LruKPolicy::onScan(size_t page_id, const PageMetadata& page, const ScanBlock& block, PageLayer& target) {
+    uint32_t now = block.epoch + 1;
+    uint32_t kth = kthAccess(page_id);
+    // An access after the block epoch was read counts as recent
+    bool hot = kth != 0 && (kth > now || now - kth <= config_.cold_access_interval);
+    return placeByHeat(page, hot, block.cold(page_id), target);
+}
+
+bool LruKPolicy::reclaimable(size_t page_id, const PageMetadata& page, uint32_t pass_epoch) {
+    (void)page;
+    // Fewer than K accesses since the previous pass started (history epochs start at 1)
+    return kthAccess(page_id) < pass_epoch + 1;
+}
+
+// ---------------------------------------------------------------------------
+// Decayed LFU
+// ---------------------------------------------------------------------------
+
+DecayedLfuPolicy::DecayedLfuPolicy(const PageTable& page_table, const PolicyConfig& config, size_t num_tiers)
+    : TieringPolicy(page_table, config, num_tiers),
+    frequency_(new std::atomic<uint32_t>[page_table.size()]) {
+    for (size_t i = 0; i < page_table.size(); ++i) {
+        frequency_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void DecayedLfuPolicy::onAccess(size_t page_id) {
+    frequency_[page_id].fetch_add(1, std::memory_order_relaxed);
+}
+
+bool DecayedLfuPolicy::onScan(size_t page_id, const PageMetadata& page, const ScanBlock& block, PageLayer& target) {
+    (void)block;
+    uint32_t frequency = frequency_[page_id].load(std::memory_order_relaxed);
+    bool hot = frequency >= config_.hot_access_cnt;
+    bool cold = frequency == 0;
+
+    // Halve the count; subtracting keeps increments that race with the decay
+    if (frequency > 0) {
+        frequency_[page_id].fetch_sub(frequency - frequency / 2, std::memory_order_relaxed);
+    }
+    return placeByHeat(page, hot, cold, target);
+}
+
+bool DecayedLfuPolicy::reclaimable(size_t page_id, const PageMetadata& page, uint32_t pass_epoch) {
+    (void)page;
+    (void)pass_epoch;
+    return frequency_[page_id].load(std::memory_order_relaxed) < config_.hot_access_cnt;
+}
+
+// ---------------------------------------------------------------------------
+// ARC
+// ---------------------------------------------------------------------------
+
+ArcPolicy::ArcPolicy(const PageTable& page_table, const PolicyConfig& config, size_t num_tiers, const ShardMap& shard_map)
+    : TieringPolicy(page_table, config, num_tiers),
+    shard_map_(shard_map),
+    shards_(page_table.size() > 0 ? shard_map.shardOf(page_table.size() - 1) + 1 : 0),
+    prev_(page_table.size(), SIZE_MAX),
+    next_(page_table.size(), SIZE_MAX),
+    list_of_(new std::atomic<uint8_t>[page_table.size()]) {
+    for (size_t i = 0; i < page_table.size(); ++i) {
+        list_of_[i].store(NONE, std::memory_order_relaxed);
+    }
+    // Split the local tier in proportion to the pages of each shard
+    size_t capacity = page_table.tierCapacity(PageLayer::NUMA_LOCAL);
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        size_t begin = i * shard_map_.shard_size;
+        size_t end = std::min(begin + shard_map_.shard_size, page_table.size());
+        shards_[i].capacity = capacity * end / page_table.size() - capacity * begin / page_table.size();
+    }
+    // Pages initially placed on the local tier start out cached in T1
+    for (size_t i = 0; i < page_table.size(); ++i) {
+        Shard& shard = shards_[shard_map_.shardOf(i)];
+        if (shard.lists[T1].size < shard.capacity && page_table.getPage(i).page_layer == PageLayer::NUMA_LOCAL) {
+            pushFront(shard, T1, i);
+        }
+    }
+}
+
+void ArcPolicy::pushFront(Shard& shard, ListId list, size_t page_id) {
+    PageList& l = shard.lists[list];
+    prev_[page_id] = SIZE_MAX;
+    next_[page_id] = l.head;
+    if (l.head != SIZE_MAX) {
+        prev_[l.head] = page_id;
+    }
+    l.head = page_id;
+    if (l.tail == SIZE_MAX) {
+        l.tail = page_id;
+    }
+    l.size++;
+    list_of_[page_id].store(list, std::memory_order_relaxed);
+}
+
+void ArcPolicy::remove(Shard& shard, size_t page_id) {
+    ListId list = static_cast<ListId>(list_of_[page_id].load(std::memory_order_relaxed));
+    if (list == NONE) {
+        return;
+    }
+    PageList& l = shard.lists[list];
+    if (prev_[page_id] != SIZE_MAX) {
+        next_[prev_[page_id]] = next_[page_id];
+    }
+    else {
+        l.head = next_[page_id];
+    }
+    if (next_[page_id] != SIZE_MAX) {
+        prev_[next_[page_id]] = prev_[page_id];
+    }
+    else {
+        l.tail = prev_[page_id];
+    }
+    l.size--;
+    list_of_[page_id].store(NONE, std::memory_order_relaxed);
+}
+
+size_t ArcPolicy::popBack(Shard& shard, ListId list) {
+    size_t page_id = shard.lists[list].tail;
+    if (page_id != SIZE_MAX) {
+        remove(shard, page_id);
+    }
+    return page_id;
+}
+
+// Evict the LRU page of T1 or T2 into its ghost list
+void ArcPolicy::replace(Shard& shard, bool in_b2) {
+    size_t t1 = shard.lists[T1].size;
+    if (t1 > 0 && ((in_b2 && t1 == shard.target_t1) || t1 > shard.target_t1 || shard.lists[T2].size == 0)) {
+        pushFront(shard, B1, popBack(shard, T1));
+    }
+    else if (shard.lists[T2].size > 0) {
+        pushFront(shard, B2, popBack(shard, T2));
+    }
+}
+
+void ArcPolicy::onAccess(size_t page_id) {
+    // Only the manager serving the page's shard gets here
+    Shard& shard = shards_[shard_map_.shardOf(page_id)];
+    if (shard.capacity == 0) {
+        return;
+    }
+    PageList* lists = shard.lists;
+
+    switch (list_of_[page_id].load(std::memory_order_relaxed)) {
+    case T1:
+    case T2:
+        // Cache hit: the page has been seen at least twice
+        if (lists[T2].head != page_id) {
+            remove(shard, page_id);
+            pushFront(shard, T2, page_id);
+        }
+        break;
+
+    case B1: {
+        // Recency ghost hit: grow T1
+        size_t delta = std::max<size_t>(lists[B2].size / lists[B1].size, 1);
+        shard.target_t1 = std::min(shard.capacity, shard.target_t1 + delta);
+        replace(shard, false);
+        remove(shard, page_id);
+        pushFront(shard, T2, page_id);
+        break;
+    }
+
+    case B2: {
+        // Frequency ghost hit: shrink T1
+        size_t delta = std::max<size_t>(lists[B1].size / lists[B2].size, 1);
+        shard.target_t1 = shard.target_t1 > delta ? shard.target_t1 - delta : 0;
+        replace(shard, true);
+        remove(shard, page_id);
+        pushFront(shard, T2, page_id);
+        break;
+    }
+
+    default: {
+        // Miss: make room in the cache and directory, then cache in T1
+        size_t l1 = lists[T1].size + lists[B1].size;
+        size_t total = l1 + lists[T2].size + lists[B2].size;
+        if (l1 >= shard.capacity) {
+            if (lists[T1].size < shard.capacity) {
+                popBack(shard, B1);
+                replace(shard, false);
+            }
+            else {
+                popBack(shard, T1);
+            }
+        }
+        else if (total >= shard.capacity) {
+            if (total >= 2 * shard.capacity) {
+                popBack(shard, B2);
+            }
+            replace(shard, false);
+        }
+        pushFront(shard, T1, page_id);
+        break;
+    }
+    }
+}
+
+bool ArcPolicy::inCache(size_t page_id) const {
+    uint8_t list = list_of_[page_id].load(std::memory_order_relaxed);
+    return list == T1 || list == T2;
+}
+
+bool ArcPolicy::onScan(size_t page_id, const PageMetadata& page, const ScanBlock& block, PageLayer& target) {
+    (void)block;
+    if (inCache(page_id)) {
+        if (page.page_layer != PageLayer::NUMA_LOCAL) {
+            target = PageLayer::NUMA_LOCAL;
+            return true;
+        }
+    }
+    else if (page.page_layer == PageLayer::NUMA_LOCAL) {
+        target = lowerLayer(PageLayer::NUMA_LOCAL);
+        return true;
+    }
+    return false;
+}
+
+bool ArcPolicy::reclaimable(size_t page_id, const PageMetadata& page, uint32_t pass_epoch) {
+    (void)page;
+    (void)pass_epoch;
+    return !inCache(page_id);
+}
+
+std::unique_ptr<TieringPolicy> makeTieringPolicy(TieringPolicyType type, const PageTable& page_table,
+    const PolicyConfig& config, size_t num_tiers, const ShardMap& shard_map) {
+    switch (type) {
+    case TieringPolicyType::CLOCK:
+        return std::make_unique<ClockPolicy>(page_table, config, num_tiers);
+    case TieringPolicyType::LRU_K:
+        return std::make_unique<LruKPolicy>(page_table, config, num_tiers);
+    case TieringPolicyType::LFU:
+        return std::make_unique<DecayedLfuPolicy>(page_table, config, num_tiers);
+    case TieringPolicyType::ARC:
+        return std::make_unique<ArcPolicy>(page_table, config, num_tiers, shard_map);
+    case TieringPolicyType::THRESHOLD:
+    default:
+        return std::make_unique<ThresholdPolicy>(page_table, config, num_tiers);
+    }
+}
@@ -0,0 +1,219 @@
+#include "Trace.hpp"
+#include "Logger.hpp"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+std::unique_ptr<TraceReader> TraceReader::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        LOG_ERROR("Cannot open trace " << path << ": " << strerror(errno));
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(TraceHeader)) {
+        LOG_ERROR("Trace " << path << " is too short for a header");
+        close(fd);
+        return nullptr;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        LOG_ERROR("Cannot map trace " << path << ": " << strerror(errno));
+        return nullptr;
+    }
+    madvise(data, size, MADV_SEQUENTIAL);
+
+    TraceHeader header;
+    memcpy(&header, data, sizeof(header));
+    bool valid = memcmp(header.magic, TraceHeader::MAGIC, sizeof(header.magic)) == 0
+        && header.version == TraceHeader::VERSION;
+    if (valid && header.encoding == static_cast<uint32_t>(TraceEncoding::FIXED)) {
+        valid = header.record_count <= (size - sizeof(TraceHeader)) / sizeof(TraceRecord);
+    }
+    else if (valid && header.encoding == static_cast<uint32_t>(TraceEncoding::VARINT_DELTA)) {
+        // Every varint record takes at least two bytes
+        valid = header.record_count <= (size - sizeof(TraceHeader)) / 2;
+    }
+    else {
+        valid = false;
+    }
+    if (!valid) {
+        LOG_ERROR("Trace " << path << " has an unsupported or corrupt header");
+        munmap(data, size);
+        return nullptr;
+    }
+    return std::unique_ptr<TraceReader>(new TraceReader(static_cast<const uint8_t*>(data), size, header));
+}
+
+TraceReader::TraceReader(const uint8_t* data, size_t size, const TraceHeader& header)
+    : data_(data), size_(size), header_(header), position_(sizeof(TraceHeader)) {
+}
+
+TraceReader::~TraceReader() {
+    munmap(const_cast<uint8_t*>(data_), size_);
+}
+
+bool TraceReader::readVarint(uint64_t& value) {
+    value = 0;
+    for (unsigned shift = 0; position_ < size_ && shift < 64; shift += 7) {
+        uint8_t byte = data_[position_++];
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TraceReader::next(TraceRecord& record) {
+    if (records_read_ == header_.record_count) {
+        return false;
+    }
+    if (encoding() == TraceEncoding::FIXED) {
+        memcpy(&record, data_ + position_, sizeof(TraceRecord));
+        position_ += sizeof(TraceRecord);
+    }
+    else {
+        uint64_t head = 0;
+        uint64_t client_id = previous_.client_id;
+        uint64_t delta_us = 0;
+        if (!readVarint(head) || ((head & 1) && !readVarint(client_id)) || !readVarint(delta_us)) {
+            LOG_ERROR("Trace ends inside record " << records_read_);
+            records_read_ = header_.record_count;
+            return false;
+        }
+        // Undo the zigzag encoding of the offset delta
+        uint64_t zigzag = head >> 2;
+        int64_t delta = static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+        record.offset = previous_.offset + static_cast<uint64_t>(delta);
+        record.op = static_cast<uint8_t>((head >> 1) & 1);
+        record.client_id = static_cast<uint16_t>(client_id);
+        record.delta_us = static_cast<uint32_t>(delta_us);
+        previous_ = record;
+    }
+    records_read_++;
+    return true;
+}
+
+std::unique_ptr<TraceWriter> TraceWriter::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        LOG_ERROR("Cannot create trace " << path << ": " << strerror(errno));
+        return nullptr;
+    }
+    // Placeholder header, the record count is filled in by close()
+    TraceHeader header;
+    memcpy(header.magic, TraceHeader::MAGIC, sizeof(header.magic));
+    header.version = TraceHeader::VERSION;
+    header.encoding = static_cast<uint32_t>(TraceEncoding::VARINT_DELTA);
+    header.record_count = 0;
+    if (write(fd, &header, sizeof(header)) != static_cast<ssize_t>(sizeof(header))) {
+        LOG_ERROR("Cannot write trace " << path << ": " << strerror(errno));
+        ::close(fd);
+        return nullptr;
+    }
+    return std::unique_ptr<TraceWriter>(new TraceWriter(fd, path));
+}
+
+TraceWriter::TraceWriter(int fd, const std::string& path)
+    : fd_(fd), path_(path), active_(BUFFER_SIZE) {
+    writer_thread_ = boost::thread(&TraceWriter::runWriter, this);
+}
+
+TraceWriter::~TraceWriter() {
+    close();
+}
+
+void TraceWriter::append(const TraceRecord& record) {
+    // Largest record: 10 byte head, 3 byte client id, 5 byte delta
+    if (active_size_ + 18 > active_.size()) {
+        submitBuffer();
+    }
+    uint8_t* out = active_.data() + active_size_;
+    int64_t delta = static_cast<int64_t>(record.offset - previous_.offset);
+    uint64_t zigzag = (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63);
+    bool client_changed = record.client_id != previous_.client_id;
+    writeVarint(out, (zigzag << 2) | (static_cast<uint64_t>(record.op & 1) << 1) | (client_changed ? 1 : 0));
+    if (client_changed) {
+        writeVarint(out, record.client_id);
+    }
+    writeVarint(out, record.delta_us);
+    active_size_ = out - active_.data();
+    previous_ = record;
+    record_count_++;
+}
+
+void TraceWriter::submitBuffer() {
+    boost::lock_guard<boost::mutex> lock(mutex_);
+    active_.resize(active_size_);
+    full_.push_back(std::move(active_));
+    if (free_.empty()) {
+        active_ = std::vector<uint8_t>(BUFFER_SIZE);
+    }
+    else {
+        active_ = std::move(free_.back());
+        free_.pop_back();
+        active_.resize(BUFFER_SIZE);
+    }
+    active_size_ = 0;
+    cond_.notify_one();
+}
+
+void TraceWriter::runWriter() {
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    while (true) {
+        cond_.wait(lock, [this]() { return closing_ || !full_.empty(); });
+        if (full_.empty()) {
+            return;
+        }
+        std::vector<uint8_t> buffer = std::move(full_.front());
+        full_.pop_front();
+
+        // Write without holding the lock so append() can keep submitting
+        lock.unlock();
+        size_t written = 0;
+        while (written < buffer.size()) {
+            ssize_t n = write(fd_, buffer.data() + written, buffer.size() - written);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                LOG_ERROR("Cannot write trace " << path_ << ": " << strerror(errno));
+                break;
+            }
+            written += static_cast<size_t>(n);
+        }
+        lock.lock();
+        free_.push_back(std::move(buffer));
+    }
+}
+
+void TraceWriter::close() {
+    if (fd_ < 0) {
+        return;
+    }
+    submitBuffer();
+    {
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        closing_ = true;
+    }
+    cond_.notify_one();
+    writer_thread_.join();
+
+    TraceHeader header;
+    memcpy(header.magic, TraceHeader::MAGIC, sizeof(header.magic));
+    header.version = TraceHeader::VERSION;
+    header.encoding = static_cast<uint32_t>(TraceEncoding::VARINT_DELTA);
+    header.record_count = record_count_;
+    if (pwrite(fd_, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) {
+        LOG_ERROR("Cannot finish trace header of " << path_ << ": " << strerror(errno));
+    }
+    ::close(fd_);
+    fd_ = -1;
+    LOG_DEBUG("Recorded " << record_count_ << " accesses to " << path_);
+}
@@ -0,0 +1,77 @@
+// Microbenchmark of the hot/cold classification kernels: pages classified
+// per second by each instruction set the CPU supports, checked against the
+// scalar kernel.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "ClassifyKernel.hpp"
+
+#define PAGE_NUM (1 << 22)
+#define ITERATIONS 20
+#define BLOCK_SIZE 64
+
+int main(int argc, char* argv[]) {
+    size_t page_num = (argc > 1) ? strtoull(argv[1], NULL, 10) : PAGE_NUM;
+    const uint32_t hot_threshold = 10;
+    const uint32_t cold_before = 5000;
+
+    // Counters and epochs spread around the thresholds
+    std::vector<uint32_t> counts(page_num);
+    std::vector<uint32_t> epochs(page_num);
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<uint32_t> count_dist(0, 2 * hot_threshold);
+    std::uniform_int_distribution<uint32_t> epoch_dist(0, 2 * cold_before);
+    for (size_t i = 0; i < page_num; i++) {
+        counts[i] = count_dist(gen);
+        epochs[i] = epoch_dist(gen);
+    }
+
+    size_t blocks = (page_num + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    std::vector<ClassifyMasks> expected(blocks);
+    std::vector<ClassifyMasks> masks(blocks);
+    ClassifyKernelFn scalar = classifyKernel(ClassifyIsa::SCALAR);
+    for (size_t b = 0; b < blocks; b++) {
+        size_t begin = b * BLOCK_SIZE;
+        size_t count = (page_num - begin < BLOCK_SIZE) ? page_num - begin : BLOCK_SIZE;
+        scalar(&counts[begin], &epochs[begin], count, hot_threshold, cold_before, expected[b]);
+    }
+
+    printf("Classifying %zu pages in blocks of %d, best kernel: %s\n",
+        page_num, BLOCK_SIZE, classifyIsaName(bestClassifyIsa()));
+
+    const ClassifyIsa isas[] = { ClassifyIsa::SCALAR, ClassifyIsa::SSE41, ClassifyIsa::AVX2 };
+    for (ClassifyIsa isa : isas) {
+        if (!classifyIsaSupported(isa)) {
+            printf("%-8s not supported\n", classifyIsaName(isa));
+            continue;
+        }
+        ClassifyKernelFn kernel = classifyKernel(isa);
+
+        uint64_t hot_pages = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int iter = 0; iter < ITERATIONS; iter++) {
+            for (size_t b = 0; b < blocks; b++) {
+                size_t begin = b * BLOCK_SIZE;
+                size_t count = (page_num - begin < BLOCK_SIZE) ? page_num - begin : BLOCK_SIZE;
+                kernel(&counts[begin], &epochs[begin], count, hot_threshold, cold_before, masks[b]);
+                hot_pages += __builtin_popcountll(masks[b].hot);
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        bool match = true;
+        for (size_t b = 0; b < blocks; b++) {
+            match &= masks[b].hot == expected[b].hot && masks[b].cold == expected[b].cold;
+        }
+        printf("%-8s %.3e pages/sec (%s, %llu hot)\n", classifyIsaName(isa),
+            page_num * (double)ITERATIONS / seconds, match ? "matches scalar" : "MISMATCH",
+            (unsigned long long)hot_pages / ITERATIONS);
+        if (!match) {
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}